@@ -0,0 +1,323 @@
+/**
+ * @file analyze.c
+ * @brief Annotating games of a PGN file with engine evaluations, see analyze.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Games are read in batches and copied, so they outlive the reader. Each game of a batch is
+ * a job of the thread pool, formatted into its own buffer, and the buffers are written
+ * out in order once the batch is done.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "analyze.h"
+#include "backend.h"
+#include "engine.h"
+#include "fen.h"
+#include "pgn.h"
+#include "pool.h"
+#include "main.h"
+
+#define ANALYZE_PV_LENGTH 8
+
+/*
+* Search result of a single position
+*/
+struct Analyzed_position {
+    // From whites point of view
+    int eval;
+
+    struct Move pv[ANALYZE_PV_LENGTH];
+    int pv_length;
+};
+
+struct Analyze_game {
+    char *text;
+    size_t size;
+
+    struct Pgn_writer output;
+
+    uint64_t positions;
+    uint64_t nodes;
+    int failed;
+
+    uint64_t blunders;
+    uint64_t mistakes;
+    uint64_t inaccuracies;
+};
+
+struct Analyze_job {
+    struct Analyze_game *games;
+    const struct Search_limits *limits;
+};
+
+/*** Constants ***/
+
+// Games analyzed before writing them out, per thread
+const int analyze_games_per_thread = 16;
+
+const int analyze_tt_size_mb = 16;
+
+// Losses against the best move in 1/1000 pawn, and their NAGs ??, ? and ?!
+const int analyze_blunder = 3000;
+const int analyze_mistake = 1000;
+const int analyze_inaccuracy = 500;
+
+const int analyze_nag_blunder = 4;
+const int analyze_nag_mistake = 2;
+const int analyze_nag_inaccuracy = 6;
+
+// Evaluations are capped at this for judging moves, all lost positions are equally lost
+const int analyze_eval_cap = 10000;
+
+/*** Annotating ***/
+
+/*
+* Evaluation as in [%eval]: pawns, or #n / #-n for mates in n moves
+*/
+void _format_eval(int eval, char* s, size_t size) {
+    int mate_in = MATE_SCORE - abs(eval);
+
+    if (mate_in <= MAX_PLY)
+        snprintf(s, size, "#%s%d", eval > 0 ? "" : "-", (mate_in + 1) / 2);
+    else
+        snprintf(s, size, "%.2f", eval / 1000.0);
+}
+
+int _capped_eval(int eval) {
+    return eval > analyze_eval_cap ? analyze_eval_cap : (eval < -analyze_eval_cap ? -analyze_eval_cap : eval);
+}
+
+/*
+* Search pos, or score it if the game is over
+*/
+void _analyze_position(struct Position* pos, const struct Search_limits* limits, struct Transposition_table* tt, struct Analyzed_position* analyzed, uint64_t* nodes) {
+    struct Move moves[MAX_MOVES];
+
+    analyzed->pv_length = 0;
+
+    if (gen_move_list(pos, moves) == 0) {
+        int mated = in_check(pos) ? MATE_SCORE : 0;
+        analyzed->eval = pos->state == white ? -mated : mated;
+        return;
+    }
+
+    struct Search_result result;
+    search(pos, limits, tt, &result);
+
+    analyzed->eval = result.eval;
+    analyzed->pv_length = result.pv_length < ANALYZE_PV_LENGTH ? result.pv_length : ANALYZE_PV_LENGTH;
+    memcpy(analyzed->pv, result.pv, sizeof(struct Move) * analyzed->pv_length);
+
+    *nodes += result.nodes;
+}
+
+/*
+* Write the moves of game with their annotations, analyzed[i] being the result of
+* positions[i]
+*/
+void _write_annotated_moves(struct Analyze_game* job, struct Game* game, struct Analyzed_position* analyzed) {
+    struct Pgn_writer *writer = &job->output;
+    char text[64], eval[16];
+
+    for (int i = 0; i < game->halfmove; i++) {
+        struct Position *pos = &game->positions[i];
+        struct Move move;
+
+        find_move(pos, &game->positions[i+1], &move);
+        pgn_write_move(writer, pos, move);
+
+        int sign = pos->state == white ? 1 : -1;
+        int loss = sign * (_capped_eval(analyzed[i].eval) - _capped_eval(analyzed[i+1].eval));
+        int nag = 0;
+
+        if (loss >= analyze_blunder) {
+            nag = analyze_nag_blunder;
+            job->blunders++;
+        }
+        else if (loss >= analyze_mistake) {
+            nag = analyze_nag_mistake;
+            job->mistakes++;
+        }
+        else if (loss >= analyze_inaccuracy) {
+            nag = analyze_nag_inaccuracy;
+            job->inaccuracies++;
+        }
+
+        if (nag)
+            pgn_write_nag(writer, nag);
+
+        // Nothing to evaluate after a mate
+        if (abs(analyzed[i+1].eval) != MATE_SCORE) {
+            _format_eval(analyzed[i+1].eval, eval, sizeof(eval));
+            snprintf(text, sizeof(text), "[%%eval %s]", eval);
+            pgn_write_comment(writer, text);
+        }
+
+        // The best move, unless the search found nothing better than the played one
+        if (nag && analyzed[i].pv_length > 0 && encode_move(analyzed[i].pv[0]) != encode_move(move)) {
+            _format_eval(analyzed[i].eval, eval, sizeof(eval));
+            snprintf(text, sizeof(text), "[%%eval %s]", eval);
+            pgn_write_variation(writer, pos, analyzed[i].pv, analyzed[i].pv_length, text);
+        }
+    }
+}
+
+void _analyze_game(int index, void* data) {
+    struct Analyze_job *job = data;
+    struct Analyze_game *analyze_game = &job->games[index];
+    struct Pgn_writer *writer = &analyze_game->output;
+
+    struct Pgn_reader reader;
+    struct Pgn_game pgn_game;
+
+    pgn_writer_open(writer, NULL);
+    pgn_open_memory(&reader, analyze_game->text, analyze_game->size);
+
+    if ( !pgn_next_game(&reader, &pgn_game) ) {
+        pgn_close(&reader);
+        return;
+    }
+
+    struct Position start = starting_position;
+    int fullmove = 1;
+
+    const struct Pgn_token *fen = pgn_find_tag(&pgn_game, "FEN");
+    char fen_string[128];
+
+    if (fen != NULL) {
+        snprintf(fen_string, sizeof(fen_string), "%.*s", fen->length, fen->start);
+        analyze_game->failed = read_fen(fen_string, &start, &fullmove) == 0;
+    }
+
+    struct Game game;
+    init_game(&game, &start, pgn_game.num_moves + 2);
+
+    if ( analyze_game->failed || !replay_pgn_game(&game, &pgn_game) ) {
+        analyze_game->failed = 1;
+        pgn_write_raw(writer, analyze_game->text, analyze_game->size);
+        pgn_write_raw(writer, "\n\n", 2);
+
+        delete_game(&game);
+        pgn_close(&reader);
+        return;
+    }
+
+    // Searched from the end, so the table knows what the earlier positions lead to
+    struct Analyzed_position *analyzed = malloc(sizeof(struct Analyzed_position) * (game.halfmove + 1));
+    uint64_t *keys = malloc(sizeof(uint64_t) * (game.halfmove + 1));
+
+    struct Transposition_table tt;
+    init_tt(&tt, analyze_tt_size_mb);
+
+    for (int i = 0; i <= game.halfmove; i++)
+        keys[i] = hash_position(&game.positions[i]);
+
+    for (int i = game.halfmove; i >= 0; i--) {
+        struct Search_limits limits = *job->limits;
+        limits.history = keys;
+        limits.history_length = i;
+
+        _analyze_position(&game.positions[i], &limits, &tt, &analyzed[i], &analyze_game->nodes);
+        analyze_game->positions++;
+    }
+
+    delete_tt(&tt);
+
+    char name[256], value[256];
+
+    for (int i = 0; i < pgn_game.num_tags; i++) {
+        snprintf(name, sizeof(name), "%.*s", pgn_game.tags[i].name.length, pgn_game.tags[i].name.start);
+        snprintf(value, sizeof(value), "%.*s", pgn_game.tags[i].value.length, pgn_game.tags[i].value.start);
+
+        if (strcmp(name, "Annotator"))
+            pgn_write_raw_tag(writer, name, value);
+    }
+
+    pgn_write_tag(writer, "Annotator", "chess");
+
+    writer->fullmove = fullmove;
+    _write_annotated_moves(analyze_game, &game, analyzed);
+    pgn_write_result(writer, pgn_game.result);
+
+    free(analyzed);
+    free(keys);
+    delete_game(&game);
+    pgn_close(&reader);
+}
+
+/*** Functions ***/
+
+int analyze_pgn(const char* in_path, const char* out_path, const struct Search_limits* limits, int num_threads, struct Analyze_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Analyze_stats));
+
+    if (num_threads <= 0)
+        num_threads = num_cores();
+
+    struct Pgn_reader reader;
+    if ( !pgn_open(&reader, in_path) )
+        return 0;
+
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) {
+        log_msg("Error in analyze_pgn(): could not open output file", error);
+        pgn_close(&reader);
+        return 0;
+    }
+
+    int batch_size = num_threads * analyze_games_per_thread;
+    struct Analyze_game *games = malloc(sizeof(struct Analyze_game) * batch_size);
+    struct Analyze_job job = { games, limits };
+    struct Pgn_game pgn_game;
+    int ret = 1, more = 1;
+
+    while (more) {
+        int num_games = 0;
+
+        while (num_games < batch_size && (more = pgn_next_game(&reader, &pgn_game))) {
+            struct Analyze_game *game = &games[num_games++];
+            memset(game, 0, sizeof(struct Analyze_game));
+
+            game->size = pgn_game.text.length;
+            game->text = malloc(game->size);
+            memcpy(game->text, pgn_game.text.start, game->size);
+        }
+
+        parallel_for(num_games, num_threads, _analyze_game, &job);
+
+        for (int i = 0; i < num_games; i++) {
+            struct Analyze_game *game = &games[i];
+
+            game->output.file = out;
+            ret = pgn_writer_close(&game->output) && ret;
+            free(game->text);
+
+            stats->games++;
+            stats->positions += game->positions;
+            stats->nodes += game->nodes;
+            stats->failed_games += game->failed;
+            stats->blunders += game->blunders;
+            stats->mistakes += game->mistakes;
+            stats->inaccuracies += game->inaccuracies;
+        }
+    }
+
+    free(games);
+    pgn_close(&reader);
+    ret = (fclose(out) == 0) && ret;
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "engine.h"
+
+struct Analyze_stats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t nodes;
+
+    // Copied unchanged, as their moves could not be replayed
+    uint64_t failed_games;
+
+    // Moves marked as blunders, mistakes and inaccuracies
+    uint64_t blunders;
+    uint64_t mistakes;
+    uint64_t inaccuracies;
+
+    double seconds;
+};
+
+/*
+* Search every position of every game in in_path within limits and write the games to
+* out_path, annotated with:
+*   - an [%eval] comment after every move, the evaluation of the position it leads to
+*   - the NAGs ?? / ? / ?! for moves losing 3 / 1 / 0.5 pawns against the best move
+*   - the line of the best move as a variation, after those
+*
+* Games are analyzed on num_threads threads (0 = one per core) and written in their
+* original order. Every game gets its own transposition table, shared by all its searches.
+* returns: success of operation
+*/
+int analyze_pgn(const char* in_path, const char* out_path, const struct Search_limits* limits, int num_threads, struct Analyze_stats* stats);
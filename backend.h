@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <stdint.h>
 
+// Upper bound for the number of moves in any position (218 legal ones at most)
+#define MAX_MOVES 256
+
 // o for empty square, capital letters = white pieces, p/P_passant for pawns that can be taken en passant
 enum Piece {
     o,
@@ -41,6 +44,18 @@ struct Position {
 
     uint8_t black_can_castle_king  : 1;
     uint8_t black_can_castle_queen : 1;
+
+    // Halfmoves since the last capture or pawn move, saturating at 255
+    uint8_t halfmove_clock;
+};
+
+/*
+* A single move. promote is o unless a pawn reaches the last rank
+*/
+struct Move {
+    uint8_t from;
+    uint8_t to;
+    enum Piece promote;
 };
 
 /*
@@ -51,7 +66,7 @@ struct Game {
     struct Position *positions;
     int max_moves;
 
-    uint8_t halfmove;
+    int halfmove;
 };
 
 int is_white(enum Piece piece);
@@ -67,6 +82,26 @@ int in_check(struct Position* pos);
 */
 void update_state(struct Position* pos);
 
+/*
+* Same as update_state() for the current position of game, also detecting draws by
+* threefold repetition and the fifty-move rule
+*/
+void update_game_state(struct Game* game);
+
+/*
+* Count earlier occurrences of the position with hash key. keys are the hashes of the
+* positions before it, most recent last. Only the last halfmove_clock of them can repeat
+* the position, anything older lies before an irreversible move
+*/
+int count_repetitions(const uint64_t* keys, int num_keys, uint64_t key, int halfmove_clock);
+
+/*
+* Write the hashes of the positions of game before the current one, at most max_keys,
+* oldest first. Positions before the last irreversible move are left out
+* returns: number of keys written
+*/
+int game_keys(struct Game* game, uint64_t* keys, int max_keys);
+
 /*
 * Check if move is legal against (already generated) arrays of all legal moves
 */
@@ -86,12 +121,31 @@ enum Piece get_piece_at(struct Position* pos, uint8_t square);
 */
 int gen_legal_moves(struct Position* pos, int allow_checks, uint8_t* from, uint8_t* to);
 
+/*
+* Zobrist hash of pos, equal for positions with equal board, side to move, castling rights
+* and en passant pawn
+*/
+uint64_t hash_position(const struct Position* pos);
+
+/*
+* Same as gen_legal_moves(pos, 0, from, to) and in_check(pos), but remembering the
+* results for the last few positions seen by the calling thread. Consecutive calls on
+* the same position (parsing a move, playing it, updating the state) generate only once
+*/
+int cached_legal_moves(struct Position* pos, uint8_t* from, uint8_t* to);
+int cached_in_check(struct Position* pos);
+
 /*
 * Initialize game to any starting position, with length max_moves
 */
 void init_game(struct Game* game, const struct Position* pos, int max_moves);
 void delete_game(struct Game* game);
 
+/*
+* Change the length of game, keeping all positions that still fit
+*/
+void resize_game(struct Game* game, int max_moves);
+
 /*
 * Play move, checking for legality
 * returns: success of operation
@@ -115,6 +169,51 @@ void unsafe_play_move_to(struct Position* crnt_position, struct Position* new_po
 */
 int eval_algebraic(struct Game* game, char s[8]);
 
-void load_pgn(struct Game* game, FILE* file);
+/*
+* Generate all legal moves, with one move per promotion piece
+* returns: number of moves
+*/
+int gen_move_list(struct Position* pos, struct Move* moves);
+
+/*
+* Find the move described in algebraic notation, without playing it. Safe to call from
+* multiple threads. Fails for illegal and ambiguous moves
+* returns: success of operation
+*/
+int parse_algebraic(struct Position* pos, const char* s, struct Move* move);
+
+/*
+* Same as parse_algebraic(), using the already generated moves of gen_move_list()
+*/
+int find_algebraic(struct Position* pos, const struct Move* moves, int num_moves, const char* s, struct Move* move);
+
+/*
+* Write move in algebraic notation, disambiguated as little as possible and with '+' / '#'
+* moves are the legal moves of pos, as generated by gen_move_list()
+* returns: length of s
+*/
+int write_algebraic(struct Position* pos, const struct Move* moves, int num_moves, struct Move move, char s[16]);
+
+/*
+* Find the move leading from crnt_pos to next_pos
+* returns: success of operation
+*/
+int find_move(struct Position* crnt_pos, struct Position* next_pos, struct Move* move);
+
+/*
+* Pack a move into 16 bits: from (6) | to (6) | promotion (3), promotion being
+* 0 = none, 1 = knight, 2 = bishop, 3 = rook, 4 = queen
+*/
+uint16_t encode_move(struct Move move);
+
+/*
+* Write move in the coordinate notation of UCI, e.g. "e2e4" or "e7e8q"
+*/
+void write_uci_move(struct Move move, char s[8]);
+
+/*
+* Unpack a move, color is the side to move (needed for the promotion piece)
+*/
+struct Move decode_move(uint16_t encoded, enum Game_state color);
 
 extern const struct Position starting_position;
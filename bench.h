@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Bench_stats {
+    int positions;
+    uint64_t nodes;
+    double seconds;
+};
+
+extern const int bench_default_depth;
+
+// Positions of the benchmark in FEN, also used as corpus by tools/microbench.c
+extern const char* bench_positions[];
+extern const int bench_num_positions;
+
+/*
+* Search every built-in position to depth on a single thread, each with a fresh
+* transposition table, and print the nodes of each position. The total number of nodes
+* only changes with the behaviour of the engine, so it doubles as a signature
+* returns: success of operation
+*/
+int run_bench(int depth, struct Bench_stats* stats);
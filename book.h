@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Opening books in Polyglot format: a sorted array of 16 byte big-endian entries
+*
+*   uint64_t key        polyglot_hash() of the position
+*   uint16_t move       to file (3) | to row (3) | from file (3) | from row (3) | promotion (3),
+*                       promotion 1 = knight ... 4 = queen, castling as king takes rook
+*   uint16_t weight     relative frequency of the move
+*   uint32_t learn      unused, 0
+*
+* Entries of the same position are adjacent, ordered by key only.
+*/
+struct Book_move {
+    struct Move move;
+    uint16_t weight;
+};
+
+/*
+* An open, memory-mapped book
+*/
+struct Book {
+    const unsigned char *data;
+    size_t size;
+    uint64_t num_entries;
+};
+
+struct Book_stats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t entries;
+
+    double seconds;
+};
+
+/*
+* Hash of pos in the way of Polyglot, with its standard random numbers, so books built by
+* other tools are found
+*/
+uint64_t polyglot_hash(const struct Position* pos);
+
+/*
+* Replace the built-in random numbers with the 781 ones in the text file at path, given
+* as hexadecimal numbers separated by white space and commas (e.g. the Random64 array of
+* the Polyglot sources). Only needed for books built with other numbers
+* returns: success of operation
+*/
+int book_load_random64(const char* path);
+
+/*
+* returns: success of operation
+*/
+int book_open(struct Book* book, const char* path);
+void book_close(struct Book* book);
+
+/*
+* Write all legal book moves of pos into moves, at most MAX_MOVES
+* returns: number of moves
+*/
+int book_probe(const struct Book* book, struct Position* pos, struct Book_move* moves);
+
+/*
+* Choose a book move of pos at random with probability proportional to the weight, seed
+* being the state of the random numbers, owned and seeded by the caller. With seed NULL,
+* the move with the highest weight
+* returns: if pos is in the book
+*/
+int book_choose_move(const struct Book* book, struct Position* pos, uint64_t* seed, struct Move* move);
+
+/*
+* Build a book of the first max_ply halfmoves of all games of a PGN file. Moves are weighted
+* with 2 points per win and 1 per draw of the side playing them, moves never leading to
+* more than a loss are left out
+* returns: success of operation
+*/
+int build_book(const char* pgn_path, const char* book_path, int max_ply, struct Book_stats* stats);
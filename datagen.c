@@ -0,0 +1,382 @@
+/**
+ * @file datagen.c
+ * @brief Self-play training data in a packed binary format, see datagen.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Every thread plays whole games with its own transposition table and collects their
+ * positions, which are appended to the shared writer once the result is known.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "datagen.h"
+#include "backend.h"
+#include "engine.h"
+#include "tb.h"
+#include "pool.h"
+#include "main.h"
+
+struct Datagen {
+    uint64_t nodes;
+    int depth;
+    int games;
+
+    // Random moves of game i are seeded with seed + i
+    uint64_t seed;
+
+    // Worker i plays games i, i + num_workers, ...
+    int num_workers;
+
+    // Guards writer and stats
+    pthread_mutex_t lock;
+    struct Packed_writer writer;
+    struct Datagen_stats *stats;
+};
+
+/*** Constants ***/
+
+// Positions buffered by readers and writers, 1 MB
+const int packed_buffer_positions = 1 << 15;
+
+const int datagen_tt_size_mb = 8;
+
+// Random moves at the start of every game
+const int datagen_random_plies = 8;
+
+// Won once the search score stays beyond resign_score for resign_plies plies
+const int datagen_resign_score = 8000;
+const int datagen_resign_plies = 8;
+
+// Games reaching this length are drawn
+const int datagen_max_plies = 400;
+
+/*** Packing ***/
+
+void pack_position(const struct Position* pos, int score, enum Game_state result, int fullmove, struct Packed_position* packed) {
+    memset(packed, 0, sizeof(struct Packed_position));
+
+    int num_pieces = 0;
+
+    for (int square = 0; square < 64; square++) {
+        if (pos->board[square] == o)
+            continue;
+
+        packed->occupancy |= (uint64_t)1 << square;
+        packed->pieces[num_pieces / 2] |= pos->board[square] << (4 * (num_pieces % 2));
+        num_pieces++;
+    }
+
+    if (score > INT16_MAX)
+        score = INT16_MAX;
+    if (score < -INT16_MAX)
+        score = -INT16_MAX;
+
+    packed->score = score;
+    packed->result = (result == white_win) ? 1 : (result == black_win ? -1 : 0);
+
+    packed->flags = (pos->state == black) |
+        pos->white_can_castle_king << 1 | pos->white_can_castle_queen << 2 |
+        pos->black_can_castle_king << 3 | pos->black_can_castle_queen << 4;
+
+    packed->halfmove_clock = pos->halfmove_clock;
+    packed->fullmove = fullmove;
+}
+
+void unpack_position(const struct Packed_position* packed, struct Position* pos, int* fullmove) {
+    memset(pos, 0, sizeof(struct Position));
+
+    uint64_t occupancy = packed->occupancy;
+    int num_pieces = 0;
+
+    while (occupancy && num_pieces < 32) {
+        int square = __builtin_ctzll(occupancy);
+        occupancy &= occupancy - 1;
+
+        pos->board[square] = (packed->pieces[num_pieces / 2] >> (4 * (num_pieces % 2))) & 15;
+        num_pieces++;
+    }
+
+    pos->state = (packed->flags & 1) ? black : white;
+    pos->white_can_castle_king = (packed->flags >> 1) & 1;
+    pos->white_can_castle_queen = (packed->flags >> 2) & 1;
+    pos->black_can_castle_king = (packed->flags >> 3) & 1;
+    pos->black_can_castle_queen = (packed->flags >> 4) & 1;
+    pos->halfmove_clock = packed->halfmove_clock;
+
+    if (fullmove != NULL)
+        *fullmove = packed->fullmove;
+}
+
+/*** Writing ***/
+
+int packed_writer_open(struct Packed_writer* writer, const char* path, int append) {
+    memset(writer, 0, sizeof(struct Packed_writer));
+
+    writer->file = fopen(path, append ? "ab" : "wb");
+    if (writer->file == NULL) {
+        log_msg("Error in packed_writer_open(): could not open file", error);
+        return 0;
+    }
+
+    writer->capacity = packed_buffer_positions;
+    writer->buffer = malloc(sizeof(struct Packed_position) * writer->capacity);
+
+    return 1;
+}
+
+void packed_write(struct Packed_writer* writer, const struct Packed_position* positions, int num_positions) {
+    while (num_positions > 0) {
+        int count = writer->capacity - writer->size;
+        if (count > num_positions)
+            count = num_positions;
+
+        memcpy(&writer->buffer[writer->size], positions, sizeof(struct Packed_position) * count);
+        writer->size += count;
+        positions += count;
+        num_positions -= count;
+
+        if (writer->size == writer->capacity)
+            packed_writer_flush(writer);
+    }
+}
+
+int packed_writer_flush(struct Packed_writer* writer) {
+    if (writer->size == 0)
+        return 1;
+
+    int ret = fwrite(writer->buffer, sizeof(struct Packed_position), writer->size, writer->file) == (size_t)writer->size;
+    ret &= fflush(writer->file) == 0;
+
+    if (!ret)
+        log_msg("Error in packed_writer_flush(): could not write", error);
+
+    writer->written += writer->size;
+    writer->size = 0;
+
+    return ret;
+}
+
+int packed_writer_close(struct Packed_writer* writer) {
+    int ret = packed_writer_flush(writer);
+    ret &= fclose(writer->file) == 0;
+
+    free(writer->buffer);
+    memset(writer, 0, sizeof(struct Packed_writer));
+
+    return ret;
+}
+
+/*** Reading ***/
+
+int packed_reader_open(struct Packed_reader* reader, const char* path) {
+    memset(reader, 0, sizeof(struct Packed_reader));
+
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        log_msg("Error in packed_reader_open(): could not open file", error);
+        return 0;
+    }
+
+    reader->buffer = malloc(sizeof(struct Packed_position) * packed_buffer_positions);
+    return 1;
+}
+
+void packed_reader_close(struct Packed_reader* reader) {
+    fclose(reader->file);
+    free(reader->buffer);
+    memset(reader, 0, sizeof(struct Packed_reader));
+}
+
+int packed_read(struct Packed_reader* reader, struct Packed_position* packed) {
+    if (reader->cursor == reader->size) {
+        reader->size = fread(reader->buffer, sizeof(struct Packed_position), packed_buffer_positions, reader->file);
+        reader->cursor = 0;
+
+        if (reader->size == 0)
+            return 0;
+    }
+
+    *packed = reader->buffer[reader->cursor++];
+    return 1;
+}
+
+/*** Self-play ***/
+
+uint64_t _datagen_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/*
+* Neither a capture nor a promotion
+*/
+int _is_quiet(const struct Position* pos, struct Move move) {
+    enum Piece piece = pos->board[move.from];
+
+    if (pos->board[move.to] != o || move.promote != o)
+        return 0;
+
+    // En passant
+    return !((piece == P || piece == p) && move.from % 8 != move.to % 8);
+}
+
+/*
+* Play game number index into positions, without results
+* returns: number of positions, the result of the game in result
+*/
+int _self_play(struct Datagen* datagen, int index, struct Transposition_table* tt, struct Packed_position** positions, int* capacity, enum Game_state* result) {
+    uint64_t random = datagen->seed + index;
+
+    struct Game game;
+    init_game(&game, &starting_position, datagen_max_plies + 2);
+    update_game_state(&game);
+
+    for (int i = 0; i < datagen_random_plies && game.positions[game.halfmove].state <= black; i++) {
+        struct Move moves[MAX_MOVES];
+        int num_moves = gen_move_list(&game.positions[game.halfmove], moves);
+        struct Move move = moves[ _datagen_random(&random) % num_moves ];
+
+        unsafe_play_move(&game, move.from, move.to, move.promote);
+        update_game_state(&game);
+    }
+
+    clear_tt(tt);
+
+    uint64_t history[UINT8_MAX];
+    int num_positions = 0;
+    int resign_plies = 0, resign_sign = 0;
+
+    while (game.positions[game.halfmove].state <= black) {
+        struct Position *pos = &game.positions[game.halfmove];
+
+        if (game.halfmove >= datagen_max_plies) {
+            pos->state = draw;
+            break;
+        }
+
+        struct Search_limits limits = { .depth = datagen->depth, .nodes = datagen->nodes };
+        limits.history = history;
+        limits.history_length = game_keys(&game, history, UINT8_MAX);
+
+        struct Search_result result;
+        search(pos, &limits, tt, &result);
+
+        int mate = abs(result.eval) >= MATE_SCORE - MAX_PLY;
+
+        if (!mate && !in_check(pos) && _is_quiet(pos, result.best_move)) {
+            if (num_positions == *capacity) {
+                *capacity = *capacity ? 2 * *capacity : 256;
+                *positions = realloc(*positions, sizeof(struct Packed_position) * *capacity);
+            }
+
+            pack_position(pos, result.eval, draw, game.halfmove / 2 + 1, &(*positions)[num_positions++]);
+        }
+
+        unsafe_play_move(&game, result.best_move.from, result.best_move.to, result.best_move.promote);
+        update_game_state(&game);
+
+        pos = &game.positions[game.halfmove];
+        if (pos->state > black)
+            break;
+
+        int wdl, dtm;
+        if ( tb_probe(pos, &wdl, &dtm) ) {
+            pos->state = (wdl == 0) ? draw : ((wdl > 0) == (pos->state == white) ? white_win : black_win);
+            break;
+        }
+
+        int sign = (result.eval >= datagen_resign_score) - (result.eval <= -datagen_resign_score);
+        resign_plies = (sign != 0 && sign == resign_sign) ? resign_plies + 1 : (sign != 0);
+        resign_sign = sign;
+
+        if (resign_plies >= datagen_resign_plies) {
+            pos->state = sign > 0 ? white_win : black_win;
+            break;
+        }
+    }
+
+    *result = game.positions[game.halfmove].state;
+    delete_game(&game);
+
+    return num_positions;
+}
+
+/*
+* Play every num_workers-th game, starting at game index
+*/
+void _datagen_worker(int index, void* data) {
+    struct Datagen *datagen = data;
+
+    struct Transposition_table tt;
+    init_tt(&tt, datagen_tt_size_mb);
+
+    struct Packed_position *positions = NULL;
+    int capacity = 0;
+
+    for (int game = index; game < datagen->games; game += datagen->num_workers) {
+        enum Game_state result;
+        int num_positions = _self_play(datagen, game, &tt, &positions, &capacity, &result);
+
+        for (int i = 0; i < num_positions; i++)
+            positions[i].result = (result == white_win) ? 1 : (result == black_win ? -1 : 0);
+
+        pthread_mutex_lock(&datagen->lock);
+
+        packed_write(&datagen->writer, positions, num_positions);
+        datagen->stats->games++;
+        datagen->stats->positions += num_positions;
+
+        pthread_mutex_unlock(&datagen->lock);
+    }
+
+    free(positions);
+    delete_tt(&tt);
+}
+
+/*** Functions ***/
+
+int generate_data(const char* path, uint64_t nodes, int depth, int games, int num_threads, struct Datagen_stats* stats) {
+    memset(stats, 0, sizeof(struct Datagen_stats));
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (num_threads <= 0)
+        num_threads = num_cores();
+
+    struct Datagen datagen = {
+        .nodes = nodes,
+        .depth = depth,
+        .games = games,
+        .seed = (uint64_t)start.tv_sec * 1000000000ull + start.tv_nsec,
+        .num_workers = num_threads,
+        .stats = stats
+    };
+    pthread_mutex_init(&datagen.lock, NULL);
+
+    if ( !packed_writer_open(&datagen.writer, path, 1) ) {
+        pthread_mutex_destroy(&datagen.lock);
+        return 0;
+    }
+
+    parallel_for(num_threads, num_threads, _datagen_worker, &datagen);
+
+    int ret = packed_writer_close(&datagen.writer);
+    pthread_mutex_destroy(&datagen.lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->bytes = stats->positions * sizeof(struct Packed_position);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Training data: positions of self-play games with the score of their search and the
+* result of their game, 32 bytes each. Files are plain arrays of records, little-endian.
+*
+* The board is stored as a bitboard of occupied squares (a1 = bit 0), followed by one
+* nibble per occupied square in order of the squares, holding the enum Piece standing on
+* it (low nibble first). En passant pawns keep their own pieces, P_passant and p_passant,
+* so no square is needed for them. A position has at most 32 pieces.
+*/
+struct Packed_position {
+    uint64_t occupancy;
+    uint8_t pieces[16];
+
+    // Search score in 1/1000 pawn from whites point of view, clamped to int16_t
+    int16_t score;
+
+    // 1 white won, 0 draw, -1 black won
+    int8_t result;
+
+    // Bit 0: black to move, bits 1 - 4: castling rights KQkq
+    uint8_t flags;
+
+    uint8_t halfmove_clock;
+    uint8_t reserved;
+    uint16_t fullmove;
+};
+
+_Static_assert(sizeof(struct Packed_position) == 32, "packed positions have 32 bytes");
+
+/*
+* Buffered, sequential output of packed positions
+*/
+struct Packed_writer {
+    FILE *file;
+    struct Packed_position *buffer;
+    int size;
+    int capacity;
+
+    uint64_t written;
+};
+
+/*
+* Streaming input of packed positions, read a buffer at a time
+*/
+struct Packed_reader {
+    FILE *file;
+    struct Packed_position *buffer;
+    int size;
+    int cursor;
+};
+
+struct Datagen_stats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t bytes;
+    double seconds;
+};
+
+void pack_position(const struct Position* pos, int score, enum Game_state result, int fullmove, struct Packed_position* packed);
+
+/*
+* fullmove may be NULL
+*/
+void unpack_position(const struct Packed_position* packed, struct Position* pos, int* fullmove);
+
+/*
+* Open path for writing, appending to it if append is set
+* returns: success of operation
+*/
+int packed_writer_open(struct Packed_writer* writer, const char* path, int append);
+
+void packed_write(struct Packed_writer* writer, const struct Packed_position* positions, int num_positions);
+
+/*
+* returns: success of operation
+*/
+int packed_writer_flush(struct Packed_writer* writer);
+
+/*
+* Flush, free the buffer and close the file
+* returns: success of operation
+*/
+int packed_writer_close(struct Packed_writer* writer);
+
+/*
+* returns: success of operation
+*/
+int packed_reader_open(struct Packed_reader* reader, const char* path);
+void packed_reader_close(struct Packed_reader* reader);
+
+/*
+* Read the next position
+* returns: 1 if a position was read, 0 at the end of the file
+*/
+int packed_read(struct Packed_reader* reader, struct Packed_position* packed);
+
+/*
+* Play games games of self-play on num_threads threads (0 = one per core) and append their
+* positions to the file at path. Every game starts with a few random moves, then each move
+* is searched with nodes nodes (or to depth, if nodes is 0). Positions in check and those
+* whose best move is a capture are left out, as their score depends on tactics
+* returns: success of operation
+*/
+int generate_data(const char* path, uint64_t nodes, int depth, int games, int num_threads, struct Datagen_stats* stats);
@@ -0,0 +1,386 @@
+/**
+ * @file db.c
+ * @brief Compact binary storage for large amounts of games
+ * @version 1.0
+ * @date 19.10.2026
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "db.h"
+#include "backend.h"
+#include "main.h"
+
+/*** Constants ***/
+
+const char db_magic[8] = "CHESSDB";
+const uint32_t db_version = 1;
+
+/*** Methods of struct Db ***/
+
+int db_open(struct Db* db, const char* path) {
+    memset(db, 0, sizeof(struct Db));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_msg("Error in db_open(): file does not exist", error);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct Db_header)) {
+        log_msg("Error in db_open(): not a database", error);
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        log_msg("Error in db_open(): could not map file", error);
+        return 0;
+    }
+
+    // Games are looked up by id, not read front to back
+    madvise(mapping, st.st_size, MADV_RANDOM);
+
+    db->data = mapping;
+    db->size = st.st_size;
+    db->header = mapping;
+
+    const struct Db_header *header = db->header;
+
+    if (
+        memcmp(header->magic, db_magic, sizeof(db_magic)) ||
+        header->version > db_version ||
+        header->header_size < sizeof(struct Db_header) ||
+        header->index_offset < header->header_size ||
+        header->index_offset % 8 ||
+        header->index_offset > db->size ||
+        header->num_games > (db->size - header->index_offset) / sizeof(struct Db_index_entry)
+    ) {
+        log_msg("Error in db_open(): not a database or unsupported version", error);
+        db_close(db);
+        return 0;
+    }
+
+    db->index = (const struct Db_index_entry*)(db->data + header->index_offset);
+    db->num_games = header->num_games;
+
+    return 1;
+}
+
+void db_close(struct Db* db) {
+    if (db->data != NULL)
+        munmap((void*)db->data, db->size);
+
+    memset(db, 0, sizeof(struct Db));
+}
+
+int db_has_game(const struct Db* db, uint64_t id) {
+    if (id >= db->num_games)
+        return 0;
+
+    const struct Db_index_entry *entry = &db->index[id];
+    uint64_t start = db->header->header_size;
+    uint64_t end = db->header->index_offset;
+
+    if (
+        entry->offset < start ||
+        entry->offset > end ||
+        entry->tags_size + 2 * (uint64_t)entry->num_moves > end - entry->offset ||
+        (entry->offset + entry->tags_size) % 2
+    )
+        return 0;
+
+    // With the last byte a '\0', no tag runs past the record
+    return entry->tags_size == 0 || db->data[entry->offset + entry->tags_size - 1] == '\0';
+}
+
+const uint16_t* db_game_moves(const struct Db* db, uint64_t id, int* num_moves) {
+    if ( !db_has_game(db, id) ) {
+        log_msg("Error in db_game_moves(): no such game or its record is corrupt", error);
+        *num_moves = 0;
+        return NULL;
+    }
+
+    const struct Db_index_entry *entry = &db->index[id];
+
+    *num_moves = entry->num_moves;
+    return (const uint16_t*)(db->data + entry->offset + entry->tags_size);
+}
+
+const char* db_game_tag(const struct Db* db, uint64_t id, const char* name) {
+    if ( !db_has_game(db, id) ) {
+        log_msg("Error in db_game_tag(): no such game or its record is corrupt", error);
+        return NULL;
+    }
+
+    const struct Db_index_entry *entry = &db->index[id];
+
+    const char *tag = db->data + entry->offset;
+    const char *end = tag + entry->tags_size;
+
+    // Padding shows up as an empty name
+    while (tag < end && *tag != '\0') {
+        const char *value = tag + strlen(tag) + 1;
+
+        if (value == end)
+            break;
+
+        if ( !strcmp(tag, name) )
+            return value;
+
+        tag = value + strlen(value) + 1;
+    }
+
+    return NULL;
+}
+
+int db_load_game(const struct Db* db, uint64_t id, struct Game* game) {
+    int num_moves;
+    const uint16_t *moves = db_game_moves(db, id, &num_moves);
+
+    if (moves == NULL)
+        return 0;
+
+    init_game(game, &starting_position, num_moves + 2);
+
+    for (int i = 0; i < num_moves; i++) {
+        struct Move move = decode_move(moves[i], game->positions[game->halfmove].state);
+        unsafe_play_move(game, move.from, move.to, move.promote);
+    }
+
+    update_game_state(game);
+
+    // Resignations, time forfeits and agreed draws only show in the result
+    enum Game_state result = db->index[id].result;
+    struct Position *pos = &game->positions[game->halfmove];
+
+    if ((pos->state == white || pos->state == black) && (result == white_win || result == black_win || result == draw))
+        pos->state = result;
+
+    return 1;
+}
+
+/*** Methods of struct Db_buffer ***/
+
+void init_db_buffer(struct Db_buffer* buffer) {
+    memset(buffer, 0, sizeof(struct Db_buffer));
+}
+
+void delete_db_buffer(struct Db_buffer* buffer) {
+    free(buffer->data);
+    free(buffer->index);
+    init_db_buffer(buffer);
+}
+
+void _reserve_data(struct Db_buffer* buffer, size_t size) {
+    if (buffer->size + size <= buffer->capacity)
+        return;
+
+    while (buffer->size + size > buffer->capacity)
+        buffer->capacity = buffer->capacity ? 2*buffer->capacity : 1 << 16;
+
+    buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+void _append_data(struct Db_buffer* buffer, const void* data, size_t size) {
+    if (size == 0)
+        return;
+
+    _reserve_data(buffer, size);
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+void db_buffer_add_game(struct Db_buffer* buffer, const struct Pgn_tag* tags, int num_tags, const uint16_t* moves, int num_moves, enum Game_state result) {
+    if (buffer->num_games == buffer->index_capacity) {
+        buffer->index_capacity = buffer->index_capacity ? 2*buffer->index_capacity : 1024;
+        buffer->index = realloc(buffer->index, sizeof(struct Db_index_entry) * buffer->index_capacity);
+    }
+
+    struct Db_index_entry *entry = &buffer->index[buffer->num_games++];
+    entry->offset = buffer->size;
+    entry->num_moves = num_moves;
+    entry->result = result;
+    entry->flags = 0;
+
+    const char zero = '\0';
+    size_t tags_size = 0;
+
+    for (int i = 0; i < num_tags; i++) {
+        size_t size = tags[i].name.length + tags[i].value.length + 2;
+
+        // tags_size is 16 bit, drop whatever does not fit
+        if (tags_size + size > UINT16_MAX)
+            break;
+
+        _append_data(buffer, tags[i].name.start, tags[i].name.length);
+        _append_data(buffer, &zero, 1);
+        _append_data(buffer, tags[i].value.start, tags[i].value.length);
+        _append_data(buffer, &zero, 1);
+
+        tags_size += size;
+    }
+
+    // Keep moves 2 byte aligned
+    if (tags_size % 2) {
+        _append_data(buffer, &zero, 1);
+        tags_size++;
+    }
+
+    entry->tags_size = tags_size;
+    _append_data(buffer, moves, sizeof(uint16_t) * num_moves);
+}
+
+int db_buffer_add_played_game(struct Db_buffer* buffer, const struct Pgn_tag* tags, int num_tags, struct Game* game) {
+    uint16_t *moves = malloc(sizeof(uint16_t) * (game->halfmove + 1));
+
+    for (int i = 0; i < game->halfmove; i++) {
+        struct Move move;
+
+        if ( !find_move(&game->positions[i], &game->positions[i+1], &move) ) {
+            log_msg("Error in db_buffer_add_played_game(): positions are not connected by a move", error);
+            free(moves);
+            return 0;
+        }
+
+        moves[i] = encode_move(move);
+    }
+
+    db_buffer_add_game(buffer, tags, num_tags, moves, game->halfmove, game->positions[game->halfmove].state);
+    free(moves);
+
+    return 1;
+}
+
+/*** Methods of struct Db_writer ***/
+
+int db_create(struct Db_writer* writer, const char* path) {
+    memset(writer, 0, sizeof(struct Db_writer));
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        log_msg("Error in db_create(): could not open file", error);
+        return 0;
+    }
+
+    // Placeholder, rewritten by db_finish()
+    struct Db_header header = {0};
+    fwrite(&header, sizeof(struct Db_header), 1, writer->file);
+    writer->offset = sizeof(struct Db_header);
+
+    return 1;
+}
+
+int db_open_append(struct Db_writer* writer, const char* path) {
+    memset(writer, 0, sizeof(struct Db_writer));
+
+    writer->file = fopen(path, "r+b");
+    if (writer->file == NULL)
+        return db_create(writer, path);
+
+    struct Db_header header;
+
+    if (
+        fread(&header, sizeof(struct Db_header), 1, writer->file) != 1 ||
+        memcmp(header.magic, db_magic, sizeof(db_magic)) ||
+        header.version != db_version ||
+        header.index_offset < sizeof(struct Db_header) ||
+        header.index_offset % 8
+    ) {
+        log_msg("Error in db_open_append(): not a database or unsupported version", error);
+        fclose(writer->file);
+        return 0;
+    }
+
+    writer->num_games = header.num_games;
+    writer->index_capacity = header.num_games > 1024 ? header.num_games : 1024;
+    writer->index = malloc(sizeof(struct Db_index_entry) * writer->index_capacity);
+
+    fseek(writer->file, header.index_offset, SEEK_SET);
+    if (fread(writer->index, sizeof(struct Db_index_entry), header.num_games, writer->file) != header.num_games) {
+        log_msg("Error in db_open_append(): could not read index", error);
+        fclose(writer->file);
+        free(writer->index);
+        return 0;
+    }
+
+    // New games go behind the old index, which stays valid until db_finish() rewrites the
+    // header. It is left as unused space between the games
+    writer->offset = header.index_offset + sizeof(struct Db_index_entry) * header.num_games;
+    fseek(writer->file, writer->offset, SEEK_SET);
+
+    return 1;
+}
+
+int db_write_buffer(struct Db_writer* writer, const struct Db_buffer* buffer) {
+    if (buffer->num_games == 0)
+        return 1;
+
+    if (fwrite(buffer->data, 1, buffer->size, writer->file) != buffer->size) {
+        log_msg("Error in db_write_buffer(): could not write games", error);
+        return 0;
+    }
+
+    if (writer->num_games + buffer->num_games > writer->index_capacity) {
+        while (writer->num_games + buffer->num_games > writer->index_capacity)
+            writer->index_capacity = writer->index_capacity ? 2*writer->index_capacity : 1024;
+
+        writer->index = realloc(writer->index, sizeof(struct Db_index_entry) * writer->index_capacity);
+    }
+
+    for (uint64_t i = 0; i < buffer->num_games; i++) {
+        struct Db_index_entry entry = buffer->index[i];
+        entry.offset += writer->offset;
+        writer->index[writer->num_games++] = entry;
+    }
+
+    writer->offset += buffer->size;
+    return 1;
+}
+
+int db_finish(struct Db_writer* writer) {
+    // Align index
+    const char padding[8] = {0};
+    int padding_size = (8 - writer->offset % 8) % 8;
+
+    fwrite(padding, 1, padding_size, writer->file);
+    writer->offset += padding_size;
+
+    struct Db_header header = {0};
+    memcpy(header.magic, db_magic, sizeof(db_magic));
+    header.version = db_version;
+    header.header_size = sizeof(struct Db_header);
+    header.num_games = writer->num_games;
+    header.index_offset = writer->offset;
+
+    int ret = fwrite(writer->index, sizeof(struct Db_index_entry), writer->num_games, writer->file) == writer->num_games;
+
+    // The header goes last, until it is on disk readers see the previous database
+    ret = ret && fflush(writer->file) == 0 && fsync(fileno(writer->file)) == 0;
+
+    fseek(writer->file, 0, SEEK_SET);
+    ret = ret && fwrite(&header, sizeof(struct Db_header), 1, writer->file) == 1;
+    ret = (fclose(writer->file) == 0) && ret;
+
+    if (!ret)
+        log_msg("Error in db_finish(): could not write index", error);
+
+    free(writer->index);
+    memset(writer, 0, sizeof(struct Db_writer));
+
+    return ret;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "pgn.h"
+
+/*
+* Binary game database, version 1. All integers are stored in host byte order
+* (little-endian on every platform we build for):
+*
+*   offset 0                struct Db_header
+*   offset header_size      game records, one after another
+*   offset index_offset     struct Db_index_entry[num_games], 8 byte aligned
+*
+* A game record consists of
+*   tags_size bytes         tags, each stored as "name\0value\0", padded with '\0' to
+*                           an even size
+*   2*num_moves bytes       moves as uint16_t in the encoding of encode_move()
+*
+* Every record starts at an even offset, so moves can be read in place. All games
+* start at starting_position. Game ids are indices into the index, starting at 0.
+*
+* Readers must reject files whose magic does not match or whose version is newer than
+* db_version, and games whose record lies outside of the game records. Writers append
+* records and a new index behind all existing data and rewrite the header last, so an
+* interrupted write leaves the previous database intact. Indices replaced this way
+* remain as unused space between the records.
+*/
+struct Db_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+
+    uint64_t num_games;
+    uint64_t index_offset;
+};
+
+struct Db_index_entry {
+    uint64_t offset;
+    uint32_t num_moves;
+    uint16_t tags_size;
+
+    // enum Game_state, white / black if the game has not concluded
+    uint8_t result;
+    uint8_t flags;
+};
+
+extern const char db_magic[8];
+extern const uint32_t db_version;
+
+/*** Reading ***/
+
+/*
+* An open, memory-mapped database. Nothing but the mapping is held in memory
+*/
+struct Db {
+    const char *data;
+    size_t size;
+
+    const struct Db_header *header;
+    const struct Db_index_entry *index;
+    uint64_t num_games;
+};
+
+/*
+* returns: success of operation
+*/
+int db_open(struct Db* db, const char* path);
+void db_close(struct Db* db);
+
+/*
+* Checked by every function reading a game, one game at a time so that opening even
+* large databases does not touch the index
+* returns: if game id exists and its record lies within the game records, with the tags
+* terminated
+*/
+int db_has_game(const struct Db* db, uint64_t id);
+
+/*
+* returns: the encoded moves of game id, pointing into the mapping, or NULL if there is no
+* such game or its record is corrupt
+*/
+const uint16_t* db_game_moves(const struct Db* db, uint64_t id, int* num_moves);
+
+/*
+* returns: value of tag name of game id, or NULL if there is no such tag or game, or its
+* record is corrupt
+*/
+const char* db_game_tag(const struct Db* db, uint64_t id, const char* name);
+
+/*
+* Initialize game and play all moves of game id. The state of the last position is
+* taken from the stored result if the moves do not decide the game
+* returns: success of operation
+*/
+int db_load_game(const struct Db* db, uint64_t id, struct Game* game);
+
+/*** Writing ***/
+
+/*
+* Serialized games waiting to be written. Offsets in index are relative to data
+*/
+struct Db_buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+
+    struct Db_index_entry *index;
+    uint64_t num_games;
+    uint64_t index_capacity;
+};
+
+void init_db_buffer(struct Db_buffer* buffer);
+void delete_db_buffer(struct Db_buffer* buffer);
+
+/*
+* Append a game consisting of num_tags tags and num_moves encoded moves
+*/
+void db_buffer_add_game(struct Db_buffer* buffer, const struct Pgn_tag* tags, int num_tags, const uint16_t* moves, int num_moves, enum Game_state result);
+
+/*
+* Append the moves played in game, up to its current halfmove
+* returns: success of operation
+*/
+int db_buffer_add_played_game(struct Db_buffer* buffer, const struct Pgn_tag* tags, int num_tags, struct Game* game);
+
+struct Db_writer {
+    FILE *file;
+    uint64_t offset;
+
+    struct Db_index_entry *index;
+    uint64_t num_games;
+    uint64_t index_capacity;
+};
+
+/*
+* Create a new, empty database at path, overwriting any existing file
+* returns: success of operation
+*/
+int db_create(struct Db_writer* writer, const char* path);
+
+/*
+* Open the database at path for appending games, creating it if it does not exist
+* returns: success of operation
+*/
+int db_open_append(struct Db_writer* writer, const char* path);
+
+/*
+* Append all games of buffer
+* returns: success of operation
+*/
+int db_write_buffer(struct Db_writer* writer, const struct Db_buffer* buffer);
+
+/*
+* Write the index and header, closes the file
+* returns: success of operation
+*/
+int db_finish(struct Db_writer* writer);
@@ -10,6 +10,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 // TODO: delete
 #include <ncurses.h>
@@ -17,70 +20,314 @@
 #include "engine.h"
 #include "main.h"
 #include "backend.h"
+#include "profile.h"
+#include "book.h"
+#include "tb.h"
+#include "simd.h"
+#include "nnue.h"
+#include "pool.h"
+
+struct Search {
+    const struct Search_limits *limits;
+    struct Transposition_table *tt;
+    const struct Eval_params *params;
+
+    struct timespec start;
+    uint64_t nodes;
+    int stop;
+
+    struct Move best_move;
+    struct Search_stats stats;
+
+    // Root moves left out, those of the lines a multi-PV search has found already
+    struct Move excluded[MAX_MULTI_PV];
+    int num_excluded;
+
+    // Hashes of the game history and the positions on the path to the current node
+    uint64_t keys[UINT8_MAX + MAX_PLY];
+    int num_keys;
+
+    // Positions on the path to the current node and their accumulators, computed when needed
+    struct Position *path[MAX_PLY + 1];
+    struct Nnue_accumulator accumulators[MAX_PLY + 1];
+    int computed[MAX_PLY + 1];
+};
+
+enum Bound {
+    bound_exact,
+    bound_lower,
+    bound_upper
+};
 
 /*** Constants ***/
 
-struct Node root;
+// Searched by choose_move()
+const struct Search_limits default_limits = { .depth = 3, .time_ms = 5000 };
+const int default_tt_size_mb = 16;
+
+// Opening book of choose_move(), if it exists
+const char *engine_book_path = "book.bin";
+
+// Endgame tablebases used by the search, if they exist
+const char *engine_tb_dir = "tb";
 
-const int material_worth[15] = {
-    0,
-    1000, 1000, 3000, 3000, 5000, 9000, 1000000,
-    -1000, -1000, -3000, -3000, -5000, -9000, -1000000
+// Network replacing static_eval(), if it exists
+const char *engine_nnue_path = "nn.nnue";
+
+// Nodes between looking at the clock
+const uint64_t time_check_interval = 256;
+
+// Tuned weights replacing the built-in ones, if they exist
+const char *engine_params_path = "eval.params";
+
+const char* eval_param_names[NUM_EVAL_PARAMS] = {
+    "pawn", "knight", "bishop", "rook", "queen",
+    "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
+    "a2", "b2", "c2", "d2", "e2", "f2", "g2", "h2",
+    "a3", "b3", "c3", "d3", "e3", "f3", "g3", "h3",
+    "a4", "b4", "c4", "d4", "e4", "f4", "g4", "h4",
+    "a5", "b5", "c5", "d5", "e5", "f5", "g5", "h5",
+    "a6", "b6", "c6", "d6", "e6", "f6", "g6", "h6",
+    "a7", "b7", "c7", "d7", "e7", "f7", "g7", "h7",
+    "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8"
 };
 
-// Controlling squares more squares = better position. Central squares > on the side
-const int positional_worth[64] = {
-    121, 121, 121, 121, 121, 121, 121, 121,
-    121, 123, 123, 123, 123, 123, 123, 121,
-    121, 123, 127, 127, 127, 127, 123, 121,
-    121, 123, 127, 129, 129, 127, 123, 121,
-    121, 123, 127, 129, 129, 127, 123, 121,
-    121, 123, 127, 127, 127, 127, 123, 121,
-    121, 123, 123, 123, 123, 123, 123, 121,
-    121, 121, 121, 121, 121, 121, 121, 121,
+// Pieces of the material parameters, white ones
+const enum Piece eval_param_pieces[5] = { P, N, B, R, Q };
+
+/*** State ***/
+
+struct Eval_params eval_params = {
+    {
+        0,
+        1000, 1000, 3000, 3000, 5000, 9000, 1000000,
+        -1000, -1000, -3000, -3000, -5000, -9000, -1000000
+    },
+
+    // Controlling squares more squares = better position. Central squares > on the side
+    {
+        121, 121, 121, 121, 121, 121, 121, 121,
+        121, 123, 123, 123, 123, 123, 123, 121,
+        121, 123, 127, 127, 127, 127, 123, 121,
+        121, 123, 127, 129, 129, 127, 123, 121,
+        121, 123, 127, 129, 129, 127, 123, 121,
+        121, 123, 127, 127, 127, 127, 123, 121,
+        121, 123, 123, 123, 123, 123, 123, 121,
+        121, 121, 121, 121, 121, 121, 121, 121,
+    }
 };
 
-int static_eval(struct Position *pos) {
-    enum Game_state crnt_state = pos->state;
-    int evaluation = 0;
+/*** Evaluation ***/
 
-    uint8_t white_from[128]; uint8_t white_to[128];
-    uint8_t black_from[128]; uint8_t black_to[128];
+/*
+* Squares controlled by white and black, one entry per legal move
+*/
+void _controlled_squares(struct Position *pos, uint8_t* white_to, int* num_white, uint8_t* black_to, int* num_black) {
+    enum Game_state crnt_state = pos->state;
+    uint8_t from[MAX_MOVES];
 
     pos->state = white;
-    int white_num_legal_moves = gen_legal_moves(pos, 0, white_from, white_to);
-    
+    *num_white = gen_legal_moves(pos, 0, from, white_to);
+
     pos->state = black;
-    int black_num_legal_moves = gen_legal_moves(pos, 0, black_from, black_to);
+    *num_black = gen_legal_moves(pos, 0, from, black_to);
 
-    // Sum up material
-    for(int square = 0; square < 64; square++) {
-        evaluation += material_worth[ (int)pos->board[square] ];
-    }
+    pos->state = crnt_state;
+}
+
+/*
+* Positional advantage of controlled squares
+*/
+int _controlled_squares_eval(struct Position *pos, const struct Eval_params* params) {
+    int evaluation = 0;
+
+    uint8_t white_to[MAX_MOVES]; uint8_t black_to[MAX_MOVES];
+    int white_num_legal_moves, black_num_legal_moves;
+
+    _controlled_squares(pos, white_to, &white_num_legal_moves, black_to, &black_num_legal_moves);
 
-    // Sum up positional advantage of controlled squares
     for(int move = 0; move < white_num_legal_moves; move ++) {
-        evaluation += positional_worth[ white_to[move] ];
+        evaluation += params->positional[ white_to[move] ];
     }
 
     for(int move = 0; move < black_num_legal_moves; move ++) {
-        evaluation -= positional_worth[ black_to[move] ];
+        evaluation -= params->positional[ black_to[move] ];
     }
 
-    // Sump up pos advantage of squares pieces stand on
-    for(int square = 0; square < 64; square ++) {
-        if ( is_white(pos->board[square]) )
-            evaluation += positional_worth[ square ];
+    return evaluation;
+}
+
+int static_eval(struct Position *pos) {
+    return static_eval_params(pos, &eval_params);
+}
+
+int static_eval_params(struct Position *pos, const struct Eval_params* params) {
+    profile_scope(zone_static_eval);
+
+    int evaluation = _controlled_squares_eval(pos, params);
+
+    // Sum up material and pos advantage of squares pieces stand on
+    int counts[15];
+    evaluation += board_terms(pos->board, params->positional, counts);
+
+    for(int piece = P; piece <= k; piece++) {
+        evaluation += counts[piece] * params->material[piece];
     }
 
-    for(int square = 0; square < black_num_legal_moves; square ++) {
-        if ( is_black(pos->board[square]) )
-            evaluation -= positional_worth[ square ];
+    return evaluation;
+}
+
+void eval_features(struct Position* pos, int8_t features[NUM_EVAL_PARAMS]) {
+    memset(features, 0, NUM_EVAL_PARAMS);
+
+    for (int square = 0; square < 64; square++) {
+        enum Piece piece = pos->board[square];
+        int side = is_white(piece) ? 1 : (is_black(piece) ? -1 : 0);
+
+        // Kings always cancel out
+        for (int i = 0; i < 5; i++) {
+            if (piece == eval_param_pieces[i] || piece == eval_param_pieces[i] + 7 || (i == 0 && (piece == P_passant || piece == p_passant)))
+                features[i] += side;
+        }
+
+        features[5 + square] += side;
     }
 
-    pos->state = crnt_state;
+    uint8_t white_to[MAX_MOVES]; uint8_t black_to[MAX_MOVES];
+    int num_white, num_black;
 
-    return evaluation;
+    _controlled_squares(pos, white_to, &num_white, black_to, &num_black);
+
+    for (int move = 0; move < num_white; move++)
+        features[5 + white_to[move]]++;
+
+    for (int move = 0; move < num_black; move++)
+        features[5 + black_to[move]]--;
+}
+
+void eval_params_to_vector(const struct Eval_params* params, int* vector) {
+    for (int i = 0; i < 5; i++)
+        vector[i] = params->material[ eval_param_pieces[i] ];
+
+    for (int square = 0; square < 64; square++)
+        vector[5 + square] = params->positional[square];
+}
+
+void eval_params_from_vector(struct Eval_params* params, const int* vector) {
+    for (int i = 0; i < 5; i++) {
+        enum Piece piece = eval_param_pieces[i];
+
+        params->material[piece] = vector[i];
+        params->material[piece + 7] = -vector[i];
+    }
+
+    params->material[P_passant] = params->material[P];
+    params->material[p_passant] = params->material[p];
+
+    for (int square = 0; square < 64; square++)
+        params->positional[square] = vector[5 + square] < 0 ? 0 : (vector[5 + square] > UINT8_MAX ? UINT8_MAX : vector[5 + square]);
+}
+
+int save_eval_params(const char* path, const struct Eval_params* params) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        log_msg("Error in save_eval_params(): could not open file", error);
+        return 0;
+    }
+
+    int vector[NUM_EVAL_PARAMS];
+    eval_params_to_vector(params, vector);
+
+    fprintf(file, "# Weights of static_eval() in 1/1000 pawn: material, then worth of squares\n");
+
+    for (int i = 0; i < NUM_EVAL_PARAMS; i++)
+        fprintf(file, "%s %d\n", eval_param_names[i], vector[i]);
+
+    return fclose(file) == 0;
+}
+
+int load_eval_params(const char* path, struct Eval_params* params) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        log_msg("Error in load_eval_params(): could not open file", error);
+        return 0;
+    }
+
+    // Parameters missing from the file keep their value
+    int vector[NUM_EVAL_PARAMS];
+    eval_params_to_vector(params, vector);
+
+    char line[256];
+    int ret = 1;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char name[32];
+        int value;
+
+        if (line[0] == '#' || sscanf(line, "%31s %d", name, &value) != 2)
+            continue;
+
+        int found = 0;
+        for (int i = 0; i < NUM_EVAL_PARAMS && !found; i++) {
+            if ( !strcmp(eval_param_names[i], name) ) {
+                vector[i] = value;
+                found = 1;
+            }
+        }
+
+        if (!found) {
+            log_printf(error, "Error in load_eval_params(): unknown parameter %s", name);
+            ret = 0;
+        }
+    }
+
+    fclose(file);
+
+    if (ret)
+        eval_params_from_vector(params, vector);
+
+    return ret;
+}
+
+struct Eval_batch_job {
+    const struct Position *positions;
+    int num_positions;
+    int *out;
+
+    struct Board_table table;
+};
+
+// Positions per work item of eval_batch()
+const int eval_batch_chunk = 8 * BOARD_BATCH;
+
+void _eval_batch_chunk(int index, void* data) {
+    struct Eval_batch_job *job = data;
+
+    int start = index * eval_batch_chunk;
+    int end = start + eval_batch_chunk < job->num_positions ? start + eval_batch_chunk : job->num_positions;
+
+    for (int first = start; first < end; first += BOARD_BATCH) {
+        struct Board_batch batch;
+        pack_board_batch(job->positions + first, end - first, &batch);
+        board_values_batch(&batch, &job->table, job->out + first);
+
+        for (int i = 0; i < batch.num_boards; i++) {
+            struct Position pos = job->positions[first + i];
+            job->out[first + i] += _controlled_squares_eval(&pos, &eval_params);
+        }
+    }
+}
+
+void eval_batch(const struct Position* positions, int n, int* out) {
+    struct Eval_batch_job *job = malloc(sizeof(struct Eval_batch_job));
+
+    job->positions = positions;
+    job->num_positions = n;
+    job->out = out;
+    init_board_table(&job->table, eval_params.material, eval_params.positional);
+
+    parallel_for((n + eval_batch_chunk - 1) / eval_batch_chunk, 0, _eval_batch_chunk, job);
+    free(job);
 }
 
 void printf_pos(struct Position* pos) {
@@ -112,192 +359,682 @@ void printf_pos(struct Position* pos) {
     }
 }
 
-void printf_node(struct Node* node) {
-    printf("parent: %p\namount children: %d\nevaluation: %d\n", node->parent, node->amount_children, node->node_content.eval);
-    printf("Position:\n\n");
+/*** Transposition table ***/
+
+void init_tt(struct Transposition_table* tt, int size_mb) {
+    uint64_t num_entries = 1;
+    while (2 * num_entries * sizeof(struct Tt_entry) <= (uint64_t)size_mb << 20)
+        num_entries *= 2;
+
+    tt->entries = calloc(num_entries, sizeof(struct Tt_entry));
+    tt->mask = num_entries - 1;
+}
+
+void clear_tt(struct Transposition_table* tt) {
+    memset(tt->entries, 0, sizeof(struct Tt_entry) * (tt->mask + 1));
+}
+
+void delete_tt(struct Transposition_table* tt) {
+    free(tt->entries);
+    tt->entries = NULL;
+}
+
+// Mates are stored relative to the node, not the root
+int _score_to_tt(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY)      return score + ply;
+    if (score <= -MATE_SCORE + MAX_PLY)     return score - ply;
+    return score;
+}
 
-    printf_pos(&node->node_content.position);
-    printf("\n_________________________\n\n");
+int _score_from_tt(int score, int ply) {
+    if (score >= MATE_SCORE - MAX_PLY)      return score - ply;
+    if (score <= -MATE_SCORE + MAX_PLY)     return score + ply;
+    return score;
+}
+
+/*** Search ***/
+
+double _elapsed_seconds(struct Search* search) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - search->start.tv_sec) + (now.tv_nsec - search->start.tv_nsec) / 1e9;
+}
+
+int _should_stop(struct Search* search) {
+    const struct Search_limits *limits = search->limits;
+
+    if (limits->nodes && search->nodes >= limits->nodes)
+        search->stop = 1;
+
+    else if (limits->time_ms && search->nodes % time_check_interval == 0)
+        search->stop = _elapsed_seconds(search) * 1000 >= limits->time_ms;
+
+    return search->stop;
+}
+
+int _is_capture(struct Position* pos, struct Move move) {
+    enum Piece piece = pos->board[move.from];
+
+    if (pos->board[move.to] != o || move.promote != o)
+        return 1;
+
+    // En passant
+    return (piece == P || piece == p) && move.from % 8 != move.to % 8;
 }
 
 /*
-* create children of single node containing all possible positions
+* Order moves: hash move, then captures (most valuable victim, least valuable attacker)
 */
-void create_children(struct Node* parent) {
-    uint8_t from[128];
-    uint8_t to[128];
+void _order_moves(struct Position* pos, struct Move* moves, int num_moves, uint16_t hash_move) {
+    int scores[MAX_MOVES];
 
-    int amount_children = gen_legal_moves( &parent->node_content.position, 0, from, to );
+    for (int i = 0; i < num_moves; i++) {
+        scores[i] = 0;
 
-    struct Node* children = malloc( sizeof(struct Node) * amount_children );
+        if (hash_move && encode_move(moves[i]) == hash_move)
+            scores[i] = 1 << 30;
 
-    for(int i = 0; i < amount_children; i++) {
-        struct Node *child = &children[i];
+        else if (_is_capture(pos, moves[i])) {
+            int victim = abs(eval_params.material[ pos->board[moves[i].to] ]);
+            int attacker = abs(eval_params.material[ pos->board[moves[i].from] ]);
 
-        child->parent = parent;
-        child->children = NULL;
-        child->amount_children = 0;
+            scores[i] = (1 << 20) + victim - attacker / 1000 + abs(eval_params.material[moves[i].promote]);
+        }
+    }
 
-        // TODO: handle promotions
-        unsafe_play_move_to(&parent->node_content.position, &child->node_content.position, from[i], to[i], o);
-        child->node_content.eval = static_eval(&child->node_content.position);
+    // Insertion sort, lists are short
+    for (int i = 1; i < num_moves; i++) {
+        struct Move move = moves[i];
+        int score = scores[i];
+        int j = i - 1;
 
-        child->node_content.did_update_eval = 0;
-    }
+        for (; j >= 0 && scores[j] < score; j--) {
+            moves[j+1] = moves[j];
+            scores[j+1] = scores[j];
+        }
 
-    parent->amount_children = amount_children;
-    parent->children = children;
+        moves[j+1] = move;
+        scores[j+1] = score;
+    }
 }
 
-const int max_depth_search_tree = 2;
+void _enter_node(struct Search* search, struct Position* pos, int ply) {
+    search->path[ply] = pos;
+    search->computed[ply] = 0;
+}
 
 /*
-* Recursively generate all possible positions up to a certain depth
+* Evaluation from the side to moves point of view. The accumulator of the network is
+* brought up to date from the last node on the path that has one
 */
-void recursive_generate(struct Node* node, int depth) {
-    if (depth > max_depth_search_tree)
-        return;
+int _relative_eval(struct Search* search, struct Position* pos, int ply) {
+    if ( !nnue_loaded() || search->limits->static_eval_only ) {
+        int eval = static_eval_params(pos, search->params);
+        return pos->state == white ? eval : -eval;
+    }
+
+    int first = ply;
+    while (first > 0 && !search->computed[first])
+        first--;
+
+    if (!search->computed[first]) {
+        nnue_refresh(search->path[first], &search->accumulators[first]);
+        search->computed[first] = 1;
+    }
+
+    for (int i = first + 1; i <= ply; i++) {
+        nnue_update(&search->accumulators[i-1], search->path[i-1], search->path[i], &search->accumulators[i]);
+        search->computed[i] = 1;
+    }
+
+    return nnue_evaluate(&search->accumulators[ply], pos->state);
+}
+
+int _quiescence(struct Search* search, struct Position* pos, int ply, int alpha, int beta) {
+    search->nodes++;
+    search->stats.qnodes++;
+
+    _enter_node(search, pos, ply);
+
+    if (ply > search->stats.seldepth)
+        search->stats.seldepth = ply;
+
+    if (_should_stop(search))
+        return 0;
+
+    int stand_pat = _relative_eval(search, pos, ply);
+
+    if (stand_pat >= beta || ply >= MAX_PLY)
+        return stand_pat;
+    if (stand_pat > alpha)
+        alpha = stand_pat;
+
+    struct Move moves[MAX_MOVES];
+    int num_moves = gen_move_list(pos, moves);
 
-    create_children(node);
-    for (int i = 0; i < node->amount_children; i++) {
-        recursive_generate( &node->children[i], depth+1 );
+    _order_moves(pos, moves, num_moves, 0);
+
+    for (int i = 0; i < num_moves; i++) {
+        if ( !_is_capture(pos, moves[i]) )
+            break;
+
+        struct Position child;
+        unsafe_play_move_to(pos, &child, moves[i].from, moves[i].to, moves[i].promote);
+
+        int score = -_quiescence(search, &child, ply + 1, -beta, -alpha);
+
+        if (search->stop)
+            return 0;
+
+        if (score >= beta)
+            return score;
+        if (score > alpha)
+            alpha = score;
     }
+
+    return alpha;
 }
 
 /*
-* Update evaluation of position based on the eval of the best possible next move
+* Quiescence search on static_eval() alone, keeping the position the best line ends in
 */
-void update_eval(struct Node* node) {
-    int eval_best_move = node->children[0].node_content.eval;
-    int index_best_move = 0;
+int _quiet_leaf(struct Position* pos, int ply, int alpha, int beta, struct Position* leaf) {
+    int stand_pat = static_eval(pos);
+    if (pos->state == black)
+        stand_pat = -stand_pat;
 
-    enum Game_state color = node->node_content.position.state;
+    *leaf = *pos;
 
-    for(int i = 0; i < node->amount_children; i++) {
-        struct Node* child = &node->children[i];
+    if (stand_pat >= beta || ply >= MAX_PLY)
+        return stand_pat;
+    if (stand_pat > alpha)
+        alpha = stand_pat;
 
-        if (color == white && child->node_content.eval > eval_best_move) {
-            eval_best_move = child->node_content.eval;
-            index_best_move = i;
-        }
+    struct Move moves[MAX_MOVES];
+    int num_moves = gen_move_list(pos, moves);
+
+    _order_moves(pos, moves, num_moves, 0);
+
+    for (int i = 0; i < num_moves && _is_capture(pos, moves[i]); i++) {
+        struct Position child, child_leaf;
+        unsafe_play_move_to(pos, &child, moves[i].from, moves[i].to, moves[i].promote);
 
-        else if (color == black && child->node_content.eval < eval_best_move) {
-            eval_best_move = child->node_content.eval;
-            index_best_move = i;
+        int score = -_quiet_leaf(&child, ply + 1, -beta, -alpha, &child_leaf);
+
+        if (score > alpha) {
+            alpha = score;
+            *leaf = child_leaf;
         }
+
+        if (score >= beta)
+            return score;
     }
 
-    node->node_content.eval = eval_best_move;
-    node->node_content.did_update_eval = 1;
+    return alpha;
+}
+
+void quiet_position(struct Position* pos, struct Position* quiet) {
+    _quiet_leaf(pos, 0, -MATE_SCORE - 1, MATE_SCORE + 1, quiet);
 }
 
 /*
-* Update all positions in a position tree recursively
+* Draw by repetition of an earlier position or by the fifty-move rule. A single repetition
+* is enough, as whatever was possible in the position is possible again
 */
-void recursive_update(struct Node* node) {
-    // if already updated: return
-    if (node->node_content.did_update_eval)
-        return;
-
-    // if no children, static eval is fine
-    else if (node->amount_children == 0) {
-        node->node_content.did_update_eval = 1;
-        return;
+int _is_draw(struct Search* search, struct Position* pos, uint64_t key) {
+    // A mate on the hundredth halfmove would still count, rare enough to ignore
+    if (pos->halfmove_clock >= 100)
+        return 1;
+
+    return count_repetitions(search->keys, search->num_keys, key, pos->halfmove_clock) > 0;
+}
+
+int _is_excluded(struct Search* search, struct Move move) {
+    for (int i = 0; i < search->num_excluded; i++) {
+        if (encode_move(search->excluded[i]) == encode_move(move))
+            return 1;
     }
 
-    // else, update children first, then self
-    else {
-        for(int i = 0; i < node->amount_children; i++) {
-            recursive_update(&node->children[i]);
+    return 0;
+}
+
+int _alpha_beta(struct Search* search, struct Position* pos, int depth, int ply, int alpha, int beta) {
+    uint64_t key = hash_position(pos);
+    _enter_node(search, pos, ply);
+
+    if (ply > 0 && _is_draw(search, pos, key))
+        return 0;
+
+    // Exact result, the distance to mate turned into a mate score
+    int wdl, dtm;
+    if ( ply > 0 && tb_probe(pos, &wdl, &dtm) ) {
+        search->stats.tb_hits++;
+        return wdl > 0 ? MATE_SCORE - ply - dtm : (wdl < 0 ? -MATE_SCORE + ply + dtm : 0);
+    }
+
+    if (depth <= 0)
+        return _quiescence(search, pos, ply, alpha, beta);
+
+    search->nodes++;
+
+    if (ply > search->stats.seldepth)
+        search->stats.seldepth = ply;
+
+    if (_should_stop(search))
+        return 0;
+
+    struct Tt_entry *entry = &search->tt->entries[key & search->tt->mask];
+    uint16_t hash_move = 0;
+
+    search->stats.tt_probes++;
+
+    if (entry->key == key) {
+        hash_move = entry->move;
+        search->stats.tt_hits++;
+
+        if (ply > 0 && entry->depth >= depth) {
+            int score = _score_from_tt(entry->score, ply);
+
+            if (
+                (entry->bound == bound_exact) ||
+                (entry->bound == bound_lower && score >= beta) ||
+                (entry->bound == bound_upper && score <= alpha)
+            ) {
+                search->stats.tt_cutoffs++;
+                return score;
+            }
         }
+    }
+
+    struct Move moves[MAX_MOVES];
+    int num_moves = gen_move_list(pos, moves);
+
+    // Checkmate or stalemate
+    if (num_moves == 0)
+        return in_check(pos) ? -MATE_SCORE + ply : 0;
 
-        update_eval(node);
+    _order_moves(pos, moves, num_moves, hash_move);
 
+    int original_alpha = alpha;
+    int best_score = -MATE_SCORE - 1;
+    struct Move best_move = moves[0];
+
+    search->keys[search->num_keys++] = key;
+
+    for (int i = 0; i < num_moves; i++) {
+        if (ply == 0 && _is_excluded(search, moves[i]))
+            continue;
+
+        struct Position child;
+        unsafe_play_move_to(pos, &child, moves[i].from, moves[i].to, moves[i].promote);
+
+        int score = -_alpha_beta(search, &child, depth - 1, ply + 1, -beta, -alpha);
+
+        if (search->stop)
+            break;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = moves[i];
+        }
+
+        if (score > alpha)
+            alpha = score;
+
+        if (alpha >= beta) {
+            search->stats.fail_highs++;
+            search->stats.fail_highs_first += (i == 0);
+            break;
+        }
     }
 
+    search->num_keys--;
+
+    if (search->stop)
+        return 0;
+
+    if (ply == 0)
+        search->best_move = best_move;
+
+    // Without its excluded moves, the root scores differently
+    if (ply == 0 && search->num_excluded > 0)
+        return best_score;
+
+    entry->key = key;
+    entry->score = _score_to_tt(best_score, ply);
+    entry->move = encode_move(best_move);
+    entry->depth = depth;
+
+    if (best_score <= original_alpha)
+        entry->bound = bound_upper;
+    else if (best_score >= beta)
+        entry->bound = bound_lower;
+    else
+        entry->bound = bound_exact;
+
+    return best_score;
 }
 
-struct Position* choose_move(struct Node* parent) {
-    log_msg("(engine) Trying to find best move...", verbose);
+/*
+* Follow the hash moves from pos, starting with best_move
+* returns: length of pv
+*/
+int _extract_pv(struct Position* pos, struct Transposition_table* tt, struct Move best_move, struct Move* pv, int max_length) {
+    struct Position positions[2];
+    positions[0] = *pos;
+
+    struct Move move = best_move;
+    int length = 0;
+
+    while (length < max_length) {
+        struct Position *crnt_pos = &positions[length % 2];
+        struct Move legal_moves[MAX_MOVES];
+        int num_legal_moves = gen_move_list(crnt_pos, legal_moves);
+        int is_legal = 0;
+
+        // Hash collisions can produce illegal moves
+        for (int i = 0; i < num_legal_moves; i++) {
+            if (encode_move(legal_moves[i]) == encode_move(move))
+                is_legal = 1;
+        }
+
+        if (!is_legal)
+            break;
+
+        pv[length++] = move;
+        unsafe_play_move_to(crnt_pos, &positions[length % 2], move.from, move.to, move.promote);
+
+        struct Position *next_pos = &positions[length % 2];
+        uint64_t key = hash_position(next_pos);
+        struct Tt_entry *entry = &tt->entries[key & tt->mask];
+
+        if (entry->key != key || entry->move == 0)
+            break;
+
+        move = decode_move(entry->move, next_pos->state);
+    }
+
+    return length;
+}
+
+void search(struct Position* pos, const struct Search_limits* limits, struct Transposition_table* tt, struct Search_result* result) {
+    struct Search search = {
+        .limits = limits,
+        .tt = tt,
+        .params = limits->params ? limits->params : &eval_params
+    };
+    clock_gettime(CLOCK_MONOTONIC, &search.start);
+
+    // Older positions cannot repeat, the halfmove clock is at most UINT8_MAX
+    if (limits->history != NULL) {
+        int length = limits->history_length < UINT8_MAX ? limits->history_length : UINT8_MAX;
+        memcpy(search.keys, limits->history + limits->history_length - length, sizeof(uint64_t) * length);
+        search.num_keys = length;
+    }
+
+    memset(result, 0, sizeof(struct Search_result));
+
+    int max_depth = (limits->depth > 0 && limits->depth < MAX_PLY) ? limits->depth : MAX_PLY;
+    int sign = pos->state == white ? 1 : -1;
 
-    log_msg("(engine) Generating decision tree...", verbose);
-    recursive_generate(parent, 0);
+    struct Move root_moves[MAX_MOVES];
+    int num_root_moves = gen_move_list(pos, root_moves);
 
-    log_msg("(engine) Updating evaluations...", verbose);
-    recursive_update(parent);
+    int num_lines = (limits->multi_pv > 1) ? limits->multi_pv : 1;
+    if (num_lines > MAX_MULTI_PV)
+        num_lines = MAX_MULTI_PV;
+    if (num_lines > num_root_moves && num_root_moves > 0)
+        num_lines = num_root_moves;
 
-    enum Game_state color = parent->node_content.position.state;
+    struct Search_line lines[MAX_MULTI_PV];
 
-    int eval_best_move;
-    int index_best_move = 0;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        search.num_excluded = 0;
 
-    if (color == white)
-        eval_best_move = -1000000;
-    else if (color == black)
-        eval_best_move = 1000000;
+        for (int i = 0; i < num_lines; i++) {
+            int score = _alpha_beta(&search, pos, depth, 0, -MATE_SCORE - 1, MATE_SCORE + 1);
 
-    for(int i = 0; i < parent->amount_children; i++) {
-        struct Node* child = &parent->children[i];
+            if (search.stop)
+                break;
 
-        if (color == white && child->node_content.eval > eval_best_move) {
-            eval_best_move = child->node_content.eval;
-            index_best_move = i;
+            lines[i].move = search.best_move;
+            lines[i].eval = sign * score;
+            lines[i].pv_length = _extract_pv(pos, tt, search.best_move, lines[i].pv, depth);
+
+            search.excluded[search.num_excluded++] = search.best_move;
         }
 
-        else if (color == black && child->node_content.eval < eval_best_move) {
-            eval_best_move = child->node_content.eval;
-            index_best_move = i;
+        // Lines of an unfinished iteration are not comparable, keep the last ones
+        if (search.stop)
+            break;
+
+        // Usually in order already, unless a later line found something the first missed
+        for (int i = 1; i < num_lines; i++) {
+            struct Search_line line = lines[i];
+            int j = i;
+
+            for (; j > 0 && sign * lines[j-1].eval < sign * line.eval; j--)
+                lines[j] = lines[j-1];
+
+            lines[j] = line;
         }
+
+        result->best_move = lines[0].move;
+        result->eval = lines[0].eval;
+        result->depth = depth;
+        result->nodes = search.nodes;
+        result->seconds = _elapsed_seconds(&search);
+
+        search.stats.nodes = search.nodes;
+        search.stats.iteration_nodes[depth] = search.nodes;
+        search.stats.iteration_seconds[depth] = result->seconds;
+        result->stats = search.stats;
+
+        memcpy(result->pv, lines[0].pv, sizeof(struct Move) * lines[0].pv_length);
+        result->pv_length = lines[0].pv_length;
+
+        memcpy(result->lines, lines, sizeof(struct Search_line) * num_lines);
+        result->num_lines = num_lines;
+
+        if (limits->on_iteration != NULL)
+            limits->on_iteration(result, limits->data);
+
+        // Found a mate in every line, searching deeper does not help
+        int all_mates = 1;
+        for (int i = 0; i < num_lines; i++)
+            all_mates &= abs(lines[i].eval) >= MATE_SCORE - MAX_PLY;
+
+        if (all_mates)
+            break;
     }
 
-    log_msg("(engine) Found best move!", verbose);
-    char msg[64];
-    snprintf(msg, 64, "(engine) Position now evaluated at: %f!", (float)(eval_best_move)/1000);
-    log_msg(msg, verbose);
+    // Not even the first iteration finished
+    if (result->depth == 0 && num_root_moves > 0) {
+        result->best_move = root_moves[0];
+        result->pv[0] = root_moves[0];
+        result->pv_length = 1;
+
+        result->lines[0].move = root_moves[0];
+        result->lines[0].pv[0] = root_moves[0];
+        result->lines[0].pv_length = 1;
+        result->num_lines = 1;
+    }
 
+    result->nodes = search.nodes;
+    result->seconds = _elapsed_seconds(&search);
 
-    return &parent->children[index_best_move].node_content.position;
+    search.stats.nodes = search.nodes;
+    result->stats = search.stats;
 }
 
+/*** Statistics ***/
 
-void init_engine() {
-    struct Node root = {
-        NULL,
-        NULL,
-        0
-    };
+double effective_branching_factor(const struct Search_result* result) {
+    int depth = result->depth;
+
+    if (depth < 2 || result->stats.iteration_nodes[depth-1] == 0)
+        return 0;
+
+    uint64_t last = result->stats.iteration_nodes[depth] - result->stats.iteration_nodes[depth-1];
+    uint64_t before = result->stats.iteration_nodes[depth-1] - result->stats.iteration_nodes[depth-2];
 
-    root.node_content.did_update_eval = 0;
+    return before ? (double)last / before : 0;
 }
 
 /*
-int main() {
-    init_log();
+* Score as UCI expects it: from the side to moves point of view, in centipawns or moves to mate
+*/
+void _write_uci_score(struct Position* pos, int eval, char score[32]) {
+    int relative = pos->state == black ? -eval : eval;
+    int mate_in = MATE_SCORE - abs(relative);
+
+    if (mate_in <= MAX_PLY)
+        snprintf(score, 32, "mate %d", relative > 0 ? (mate_in + 1) / 2 : -(mate_in + 1) / 2);
+    else
+        snprintf(score, 32, "cp %d", relative / 10);
+}
 
-    struct Game game;
-    init_game(&game, &starting_position, 128);
+void print_uci_info(FILE* file, struct Position* pos, const struct Search_result* result) {
+    double seconds = result->seconds > 0 ? result->seconds : 1e-9;
+    int multi_pv = result->num_lines > 1;
 
-    struct Node root = {
-        NULL,
-        NULL,
-        0,
-        {
-            game.positions[0],
-            static_eval(&game.positions[0])
+    for (int line = 0; line < (multi_pv ? result->num_lines : 1); line++) {
+        const struct Move *pv = multi_pv ? result->lines[line].pv : result->pv;
+        int pv_length = multi_pv ? result->lines[line].pv_length : result->pv_length;
+
+        char score[32];
+        _write_uci_score(pos, multi_pv ? result->lines[line].eval : result->eval, score);
+
+        fprintf(file, "info depth %d seldepth %d", result->depth, result->stats.seldepth);
+
+        if (multi_pv)
+            fprintf(file, " multipv %d", line + 1);
+
+        fprintf(file, " score %s nodes %llu nps %.0f tbhits %llu time %.0f pv",
+            score, (unsigned long long)result->nodes, result->nodes / seconds,
+            (unsigned long long)result->stats.tb_hits, result->seconds * 1000
+        );
+
+        for (int i = 0; i < pv_length; i++) {
+            char move[8];
+            write_uci_move(pv[i], move);
+            fprintf(file, " %s", move);
         }
-    };
 
-    create_children(&root);
-    eval_children(&root);
+        fprintf(file, "\n");
+    }
+
+    fflush(file);
+}
+
+void print_search_json(FILE* file, struct Position* pos, const struct Search_result* result) {
+    const struct Search_stats *stats = &result->stats;
+    double seconds = result->seconds > 0 ? result->seconds : 1e-9;
+
+    char best_move[8];
+    write_uci_move(result->best_move, best_move);
+
+    char score[32];
+    _write_uci_score(pos, result->eval, score);
+
+    fprintf(file, "{\"best_move\": \"%s\", \"score\": \"%s\", \"depth\": %d, \"seldepth\": %d, ",
+        best_move, score, result->depth, stats->seldepth);
+
+    fprintf(file, "\"nodes\": %llu, \"qnodes\": %llu, \"time_ms\": %.1f, \"nps\": %.0f, ",
+        (unsigned long long)stats->nodes, (unsigned long long)stats->qnodes, result->seconds * 1000, stats->nodes / seconds);
 
-    for(int i = 0; i < 20; i++){
-        printf_node(&root.children[i]);
+    fprintf(file, "\"tt_probes\": %llu, \"tt_hits\": %llu, \"tt_cutoffs\": %llu, \"tb_hits\": %llu, ",
+        (unsigned long long)stats->tt_probes, (unsigned long long)stats->tt_hits, (unsigned long long)stats->tt_cutoffs,
+        (unsigned long long)stats->tb_hits);
+
+    fprintf(file, "\"fail_highs\": %llu, \"fail_high_first_rate\": %.3f, \"ebf\": %.2f, \"iterations\": [",
+        (unsigned long long)stats->fail_highs, stats->fail_highs ? (double)stats->fail_highs_first / stats->fail_highs : 0.0,
+        effective_branching_factor(result));
+
+    for (int depth = 1; depth <= result->depth; depth++) {
+        fprintf(file, "%s{\"depth\": %d, \"nodes\": %llu, \"time_ms\": %.1f}", depth > 1 ? ", " : "",
+            depth, (unsigned long long)(stats->iteration_nodes[depth] - stats->iteration_nodes[depth-1]),
+            (stats->iteration_seconds[depth] - stats->iteration_seconds[depth-1]) * 1000);
     }
 
-    printf("Best move:\n");
+    fprintf(file, "]");
 
-    printf_pos( choose_move(&root) );
+    if (result->num_lines > 1) {
+        fprintf(file, ", \"lines\": [");
 
-    return 0;
+        for (int line = 0; line < result->num_lines; line++) {
+            _write_uci_score(pos, result->lines[line].eval, score);
+            fprintf(file, "%s{\"score\": \"%s\", \"pv\": \"", line > 0 ? ", " : "", score);
+
+            for (int i = 0; i < result->lines[line].pv_length; i++) {
+                char move[8];
+                write_uci_move(result->lines[line].pv[i], move);
+                fprintf(file, "%s%s", i > 0 ? " " : "", move);
+            }
+
+            fprintf(file, "\"}");
+        }
+
+        fprintf(file, "]");
+    }
+
+    fprintf(file, "}\n");
+    fflush(file);
+}
+
+/*** Playing ***/
+
+struct Transposition_table engine_tt;
+struct Book engine_book;
+uint64_t engine_book_seed;
+struct Position engine_position;
+
+struct Position* choose_move(struct Game* game) {
+    log_msg("(engine) Trying to find best move...", verbose);
+
+    struct Position *pos = &game->positions[game->halfmove];
+    struct Move book_move;
+
+    if ( book_choose_move(&engine_book, pos, &engine_book_seed, &book_move) ) {
+        log_msg("(engine) Playing book move", verbose);
+        unsafe_play_move_to(pos, &engine_position, book_move.from, book_move.to, book_move.promote);
+        return &engine_position;
+    }
+
+    uint64_t history[UINT8_MAX];
+
+    struct Search_limits limits = default_limits;
+    limits.history = history;
+    limits.history_length = game_keys(game, history, UINT8_MAX);
+
+    struct Search_result result;
+    search(pos, &limits, &engine_tt, &result);
+
+    unsafe_play_move_to(pos, &engine_position, result.best_move.from, result.best_move.to, result.best_move.promote);
+
+    log_msg("(engine) Found best move!", verbose);
+    log_printf(verbose, "(engine) Position now evaluated at: %f!", (float)(result.eval)/1000);
+
+    return &engine_position;
+}
+
+void load_engine_files() {
+    // All of them are optional
+    if (access(engine_book_path, R_OK) == 0)
+        book_open(&engine_book, engine_book_path);
+    engine_book_seed = time(NULL);
+
+    tb_init(engine_tb_dir);
+
+    if (access(engine_nnue_path, R_OK) == 0)
+        nnue_load(engine_nnue_path);
+
+    if (access(engine_params_path, R_OK) == 0)
+        load_eval_params(engine_params_path, &eval_params);
+}
+
+void init_engine() {
+    init_tt(&engine_tt, default_tt_size_mb);
+    load_engine_files();
 }
-*/
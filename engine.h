@@ -1,24 +1,225 @@
 #pragma once
 
+#include <stdio.h>
+#include <stdint.h>
+
 #include "backend.h"
 
-extern struct Node root;
+// Scores at or above mate_score - max_ply are mates
+#define MATE_SCORE 100000000
+#define MAX_PLY 128
+
+// Most lines a multi-PV search reports
+#define MAX_MULTI_PV 16
+
+struct Tt_entry {
+    uint64_t key;
+    int32_t score;
+    uint16_t move;
+    int8_t depth;
+    uint8_t bound;
+};
+
+/*
+* Transposition table, owned by one search at a time
+*/
+struct Transposition_table {
+    struct Tt_entry *entries;
+    uint64_t mask;
+};
+
+struct Search_result;
+struct Eval_params;
+
+/*
+* Limits of a single search, 0 meaning unlimited. Without any limit, searches to MAX_PLY
+*/
+struct Search_limits {
+    int depth;
+    uint64_t nodes;
+    int time_ms;
+
+    // Called after every completed iteration, may be NULL
+    void (*on_iteration)(const struct Search_result* result, void* data);
+    void *data;
+
+    // Hashes of the positions played before the searched one, oldest first, as written
+    // by game_keys(). Needed to see repetitions of earlier positions, may be NULL
+    const uint64_t *history;
+    int history_length;
+
+    // Weights of static_eval() to search with, NULL for eval_params
+    const struct Eval_params *params;
+
+    // Evaluate with static_eval() even if a network is loaded
+    int static_eval_only;
 
-struct Node_content {
-    struct Position position;
+    // Number of best root moves to find with their lines, at most MAX_MULTI_PV. 0 or 1
+    // for a normal search
+    int multi_pv;
+};
+
+/*
+* Counters of a single search, collected by the searching thread only
+*/
+struct Search_stats {
+    // nodes includes qnodes
+    uint64_t nodes;
+    uint64_t qnodes;
+
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t tt_cutoffs;
+
+    // Positions looked up in the endgame tablebases
+    uint64_t tb_hits;
+
+    // Beta cutoffs, and how many of them by the first move searched
+    uint64_t fail_highs;
+    uint64_t fail_highs_first;
+
+    // Deepest ply reached, quiescence included
+    int seldepth;
+
+    // Totals after each completed iteration, indexed by depth
+    uint64_t iteration_nodes[MAX_PLY + 1];
+    double iteration_seconds[MAX_PLY + 1];
+};
+
+/*
+* A root move of a multi-PV search with its line
+*/
+struct Search_line {
+    struct Move move;
+
+    // From whites point of view
     int eval;
-    int did_update_eval;
+
+    // Starting with the root move
+    struct Move pv[MAX_PLY];
+    int pv_length;
 };
 
-struct Node {
-    struct Node *parent;
-    struct Node *children;
-    int amount_children;
+struct Search_result {
+    struct Move best_move;
 
-    struct Node_content node_content;
+    // From whites point of view, like static_eval()
+    int eval;
+
+    // Deepest completed iteration
+    int depth;
+
+    uint64_t nodes;
+    double seconds;
+
+    // Principal variation, starting with best_move
+    struct Move pv[MAX_PLY];
+    int pv_length;
+
+    // Best first. lines[0] is the principal variation, there are more with multi_pv
+    struct Search_line lines[MAX_MULTI_PV];
+    int num_lines;
+
+    struct Search_stats stats;
+};
+
+void init_tt(struct Transposition_table* tt, int size_mb);
+void clear_tt(struct Transposition_table* tt);
+void delete_tt(struct Transposition_table* tt);
+
+/*
+* Weights of static_eval(), in 1/1000 pawn. The material of black pieces is negative
+*/
+struct Eval_params {
+    int material[15];
+
+    // Worth of a square, for each piece on it and each move to it
+    uint8_t positional[64];
 };
 
-struct Position* choose_move(struct Node* parent);
+/*
+* Tunable parameters as a vector: material of pawn, knight, bishop, rook, queen, then the
+* worth of squares a1 to h8
+*/
+#define NUM_EVAL_PARAMS (5 + 64)
+
+extern struct Eval_params eval_params;
+extern const char* eval_param_names[NUM_EVAL_PARAMS];
+
+int static_eval(struct Position *pos);
+
+/*
+* Same as static_eval(), with params instead of eval_params
+*/
+int static_eval_params(struct Position *pos, const struct Eval_params* params);
+
+/*
+* Decompose static_eval(): it is the sum of eval_params as vector times features
+*/
+void eval_features(struct Position* pos, int8_t features[NUM_EVAL_PARAMS]);
+
+void eval_params_to_vector(const struct Eval_params* params, int* vector);
+
+/*
+* Set params from vector, clamping the worth of squares to [0, 255]
+*/
+void eval_params_from_vector(struct Eval_params* params, const int* vector);
+
+/*
+* Parameter files have one "name value" line per parameter, e.g. "knight 3000" or "e4 129".
+* Parameters missing from the file are left unchanged
+* returns: success of operation
+*/
+int load_eval_params(const char* path, struct Eval_params* params);
+int save_eval_params(const char* path, const struct Eval_params* params);
+
+/*
+* Resolve captures with a quiescence search on static_eval()
+* quiet: the position at the end of the best line
+*/
+void quiet_position(struct Position* pos, struct Position* quiet);
+
+/*
+* static_eval() of n positions into out, spread over all cores. Boards are evaluated
+* BOARD_BATCH at a time, in structure-of-arrays layout
+*/
+void eval_batch(const struct Position* positions, int n, int* out);
+
+/*
+* Iterative deepening alpha-beta search of pos. Safe to call from multiple threads at
+* once, as long as each uses its own tt.
+*
+* With multi_pv, every iteration searches the root once per line, excluding the root moves
+* of the lines found before. All of them share tt, so later lines are mostly cheap
+*/
+void search(struct Position* pos, const struct Search_limits* limits, struct Transposition_table* tt, struct Search_result* result);
+
+/*
+* Nodes of the last iteration per node of the one before, 0 if unknown
+*/
+double effective_branching_factor(const struct Search_result* result);
+
+/*
+* Print result as UCI info line ("info depth ... pv ..."), pos being the searched position.
+* Multi-PV results get one line per root move, numbered by "multipv"
+*/
+void print_uci_info(FILE* file, struct Position* pos, const struct Search_result* result);
+
+/*
+* Print result and all statistics as a single JSON object
+*/
+void print_search_json(FILE* file, struct Position* pos, const struct Search_result* result);
+
+/*
+* Search the current position of game with the engines default limits
+* returns: the position after the best move
+*/
+struct Position* choose_move(struct Game* game);
 
+/*
+* Open the opening book, endgame tablebases and network of the engine, those that exist
+* in the working directory
+*/
+void load_engine_files();
 
-void init_engine();
\ No newline at end of file
+void init_engine();
@@ -0,0 +1,232 @@
+/**
+ * @file epd.c
+ * @brief Running test suites of positions in extended position description
+ * @version 1.0
+ * @date 19.10.2026
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "epd.h"
+#include "backend.h"
+#include "engine.h"
+#include "fen.h"
+#include "pool.h"
+#include "main.h"
+
+struct Epd_run {
+    struct Epd_entry entry;
+
+    struct Search_result result;
+    int solved;
+
+    // Time of the iteration since which the best move solves the position
+    double solved_since;
+};
+
+struct Epd_job {
+    struct Epd_run *runs;
+    const struct Search_limits *limits;
+};
+
+/*** Constants ***/
+
+const int epd_tt_size_mb = 16;
+
+/*** Reading ***/
+
+int _moves_equal(struct Move a, struct Move b) {
+    return a.from == b.from && a.to == b.to && a.promote == b.promote;
+}
+
+/*
+* Read the space separated moves of an operand
+*/
+int _read_epd_moves(struct Position* pos, char* operand, struct Move* moves) {
+    struct Move legal_moves[MAX_MOVES];
+    int num_legal_moves = gen_move_list(pos, legal_moves);
+    int num_moves = 0;
+
+    for (char *san = strtok(operand, " \t"); san != NULL && num_moves < 8; san = strtok(NULL, " \t")) {
+        if ( !find_algebraic(pos, legal_moves, num_legal_moves, san, &moves[num_moves]) )
+            return -1;
+        num_moves++;
+    }
+
+    return num_moves;
+}
+
+int read_epd(const char* line, struct Epd_entry* entry) {
+    memset(entry, 0, sizeof(struct Epd_entry));
+
+    int length = read_fen(line, &entry->position, NULL);
+    if (length == 0)
+        return 0;
+
+    // Operations: opcode operand; opcode operand; ...
+    char operations[1024];
+    snprintf(operations, sizeof(operations), "%s", line + length);
+
+    char *saveptr;
+    for (char *operation = strtok_r(operations, ";", &saveptr); operation != NULL; operation = strtok_r(NULL, ";", &saveptr)) {
+        operation += strspn(operation, " \t\r\n");
+
+        char *operand = operation + strcspn(operation, " \t");
+        if (*operand != '\0')
+            *operand++ = '\0';
+        operand[strcspn(operand, "\r\n")] = '\0';
+
+        if ( !strcmp(operation, "bm") ) {
+            entry->num_best_moves = _read_epd_moves(&entry->position, operand, entry->best_moves);
+            if (entry->num_best_moves < 0)
+                return 0;
+        }
+
+        else if ( !strcmp(operation, "am") ) {
+            entry->num_avoid_moves = _read_epd_moves(&entry->position, operand, entry->avoid_moves);
+            if (entry->num_avoid_moves < 0)
+                return 0;
+        }
+
+        else if ( !strcmp(operation, "id") ) {
+            operand += strspn(operand, " \t\"");
+            snprintf(entry->id, sizeof(entry->id), "%.*s", (int)strcspn(operand, "\""), operand);
+        }
+    }
+
+    return 1;
+}
+
+int epd_solved(const struct Epd_entry* entry, struct Move move) {
+    for (int i = 0; i < entry->num_avoid_moves; i++) {
+        if (_moves_equal(entry->avoid_moves[i], move))
+            return 0;
+    }
+
+    for (int i = 0; i < entry->num_best_moves; i++) {
+        if (_moves_equal(entry->best_moves[i], move))
+            return 1;
+    }
+
+    // Only moves to avoid given
+    return entry->num_best_moves == 0;
+}
+
+/*** Running ***/
+
+void _on_iteration(const struct Search_result* result, void* data) {
+    struct Epd_run *run = data;
+
+    if ( !epd_solved(&run->entry, result->best_move) )
+        run->solved_since = -1;
+    else if (run->solved_since < 0)
+        run->solved_since = result->seconds;
+}
+
+void _run_position(int index, void* data) {
+    struct Epd_job *job = data;
+    struct Epd_run *run = &job->runs[index];
+
+    struct Search_limits limits = *job->limits;
+    limits.on_iteration = _on_iteration;
+    limits.data = run;
+
+    struct Transposition_table tt;
+    init_tt(&tt, epd_tt_size_mb);
+
+    run->solved_since = -1;
+    search(&run->entry.position, &limits, &tt, &run->result);
+    run->solved = epd_solved(&run->entry, run->result.best_move);
+
+    delete_tt(&tt);
+}
+
+int run_epd_suite(const char* path, const struct Search_limits* limits, int num_threads, struct Epd_stats* stats) {
+    memset(stats, 0, sizeof(struct Epd_stats));
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        log_msg("Error in run_epd_suite(): file does not exist", error);
+        return 0;
+    }
+
+    struct Epd_run *runs = NULL;
+    int num_runs = 0, capacity = 0;
+    char line[1024];
+    int ret = 1;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        if (num_runs == capacity) {
+            capacity = capacity ? 2*capacity : 64;
+            runs = realloc(runs, sizeof(struct Epd_run) * capacity);
+        }
+
+        memset(&runs[num_runs], 0, sizeof(struct Epd_run));
+
+        if ( !read_epd(line, &runs[num_runs].entry) ) {
+            fprintf(stderr, "Skipping malformed line: %s", line);
+            ret = 0;
+            continue;
+        }
+
+        num_runs++;
+    }
+    fclose(file);
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct Epd_job job = { runs, limits };
+    parallel_for(num_runs, num_threads, _run_position, &job);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    for (int i = 0; i < num_runs; i++) {
+        struct Epd_run *run = &runs[i];
+
+        struct Move legal_moves[MAX_MOVES];
+        int num_legal_moves = gen_move_list(&run->entry.position, legal_moves);
+
+        char san[16] = "-";
+        if (num_legal_moves > 0)
+            write_algebraic(&run->entry.position, legal_moves, num_legal_moves, run->result.best_move, san);
+
+        char eval[16];
+        int mate_in = MATE_SCORE - abs(run->result.eval);
+
+        if (mate_in <= MAX_PLY)
+            snprintf(eval, sizeof(eval), "%s#%d", run->result.eval > 0 ? "+" : "-", (mate_in + 1) / 2);
+        else
+            snprintf(eval, sizeof(eval), "%+.2f", run->result.eval / 1000.0);
+
+        printf("%-24s %-8s %-7s depth %2d  eval %8s  nodes %10llu",
+            run->entry.id[0] ? run->entry.id : "-", san, run->solved ? "solved" : "failed",
+            run->result.depth, eval, (unsigned long long)run->result.nodes
+        );
+        if (run->solved)
+            printf("  after %.3fs", run->solved_since);
+        printf("\n");
+
+        stats->positions++;
+        stats->nodes += run->result.nodes;
+
+        if (run->solved) {
+            stats->solved++;
+            stats->time_to_solution += run->solved_since;
+        }
+    }
+
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    free(runs);
+    return ret;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "backend.h"
+#include "engine.h"
+
+/*
+* A position of a test suite, with the moves to find (bm) or to avoid (am)
+*/
+struct Epd_entry {
+    struct Position position;
+    char id[64];
+
+    struct Move best_moves[8];
+    int num_best_moves;
+
+    struct Move avoid_moves[8];
+    int num_avoid_moves;
+};
+
+struct Epd_stats {
+    int positions;
+    int solved;
+
+    // Summed up over all solved positions
+    double time_to_solution;
+
+    uint64_t nodes;
+    double seconds;
+};
+
+/*
+* Read a line in extended position description, e.g.
+*   r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - bm Bb5; id "test 1";
+* returns: success of operation
+*/
+int read_epd(const char* line, struct Epd_entry* entry);
+
+/*
+* returns: if move solves entry
+*/
+int epd_solved(const struct Epd_entry* entry, struct Move move);
+
+/*
+* Search every position of the suite at path within limits, num_threads positions at a
+* time (0 = one per core), and print the result of each position
+* returns: success of operation
+*/
+int run_epd_suite(const char* path, const struct Search_limits* limits, int num_threads, struct Epd_stats* stats);
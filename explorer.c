@@ -0,0 +1,308 @@
+/**
+ * @file explorer.c
+ * @brief Opening explorer index of a game database, see explorer.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Building replays chunks of games in parallel. Every chunk collects one entry per move
+ * played, sorts them and merges equal moves of equal positions, then all chunks are
+ * merged the same way.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "explorer.h"
+#include "backend.h"
+#include "db.h"
+#include "pool.h"
+#include "main.h"
+
+struct Explorer_chunk {
+    uint64_t first_game;
+    uint64_t num_games;
+
+    struct Explorer_entry *entries;
+    uint64_t num_entries;
+    uint64_t games;
+};
+
+struct Explorer_job {
+    const struct Db *db;
+    struct Explorer_chunk *chunks;
+    int max_ply;
+};
+
+/*** Constants ***/
+
+const char explorer_magic[8] = "CHESSEXP";
+const uint32_t explorer_version = 1;
+
+const uint64_t explorer_chunk_games = 4096;
+
+/*** Building ***/
+
+int _compare_explorer_entries(const void* a, const void* b) {
+    const struct Explorer_entry *x = a, *y = b;
+
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return (int)x->move - (int)y->move;
+}
+
+/*
+* Sort entries and add up the results of equal moves
+* returns: number of entries left
+*/
+uint64_t _merge_explorer_entries(struct Explorer_entry* entries, uint64_t num_entries) {
+    qsort(entries, num_entries, sizeof(struct Explorer_entry), _compare_explorer_entries);
+
+    uint64_t merged = 0;
+
+    for (uint64_t i = 0; i < num_entries; i++) {
+        if (merged > 0) {
+            struct Explorer_entry *last = &entries[merged - 1];
+
+            if (last->key == entries[i].key && last->move == entries[i].move) {
+                last->white_wins += entries[i].white_wins;
+                last->draws += entries[i].draws;
+                last->black_wins += entries[i].black_wins;
+                continue;
+            }
+        }
+
+        entries[merged++] = entries[i];
+    }
+
+    return merged;
+}
+
+void _explore_chunk(int index, void* data) {
+    struct Explorer_job *job = data;
+    struct Explorer_chunk *chunk = &job->chunks[index];
+    uint64_t capacity = 0;
+
+    for (uint64_t id = chunk->first_game; id < chunk->first_game + chunk->num_games; id++) {
+        enum Game_state result = job->db->index[id].result;
+
+        // Unfinished games say nothing about the moves
+        if (result != white_win && result != black_win && result != draw)
+            continue;
+
+        int num_moves;
+        const uint16_t *moves = db_game_moves(job->db, id, &num_moves);
+
+        if (moves == NULL)
+            continue;
+
+        struct Position positions[2];
+        positions[0] = starting_position;
+
+        for (int i = 0; i < num_moves && i < job->max_ply; i++) {
+            struct Position *crnt_pos = &positions[i % 2];
+            struct Move move = decode_move(moves[i], crnt_pos->state);
+
+            if (chunk->num_entries == capacity) {
+                capacity = capacity ? 2 * capacity : 1 << 14;
+                chunk->entries = realloc(chunk->entries, sizeof(struct Explorer_entry) * capacity);
+            }
+
+            chunk->entries[chunk->num_entries++] = (struct Explorer_entry) {
+                hash_position(crnt_pos), moves[i], 0,
+                result == white_win, result == draw, result == black_win
+            };
+
+            unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+        }
+
+        chunk->games++;
+    }
+
+    chunk->num_entries = _merge_explorer_entries(chunk->entries, chunk->num_entries);
+}
+
+/*** Reading ***/
+
+int explorer_open(struct Explorer* explorer, const char* path) {
+    memset(explorer, 0, sizeof(struct Explorer));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_msg("Error in explorer_open(): file does not exist", error);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct Explorer_header)) {
+        log_msg("Error in explorer_open(): not an explorer index", error);
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        log_msg("Error in explorer_open(): could not map file", error);
+        return 0;
+    }
+
+    explorer->data = mapping;
+    explorer->size = st.st_size;
+    explorer->header = mapping;
+
+    const struct Explorer_header *header = explorer->header;
+
+    if (
+        memcmp(header->magic, explorer_magic, sizeof(explorer_magic)) ||
+        header->version > explorer_version ||
+        header->num_entries > (explorer->size - sizeof(struct Explorer_header)) / sizeof(struct Explorer_entry)
+    ) {
+        log_msg("Error in explorer_open(): not an explorer index or unsupported version", error);
+        explorer_close(explorer);
+        return 0;
+    }
+
+    explorer->entries = (const struct Explorer_entry*)(explorer->data + sizeof(struct Explorer_header));
+    explorer->num_entries = header->num_entries;
+
+    return 1;
+}
+
+void explorer_close(struct Explorer* explorer) {
+    if (explorer->data != NULL)
+        munmap((void*)explorer->data, explorer->size);
+
+    memset(explorer, 0, sizeof(struct Explorer));
+}
+
+int _compare_explorer_moves(const void* a, const void* b) {
+    const struct Explorer_move *x = a, *y = b;
+
+    if (x->games != y->games)
+        return x->games > y->games ? -1 : 1;
+    return 0;
+}
+
+int explorer_probe(const struct Explorer* explorer, struct Position* pos, struct Explorer_move* moves) {
+    if (explorer->num_entries == 0)
+        return 0;
+
+    uint64_t key = hash_position(pos);
+
+    // First entry with a key not less than key
+    uint64_t low = 0, high = explorer->num_entries;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+
+        if (explorer->entries[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    struct Move legal_moves[MAX_MOVES];
+    int num_legal_moves = gen_move_list(pos, legal_moves);
+    int num_moves = 0;
+
+    for (uint64_t i = low; i < explorer->num_entries && explorer->entries[i].key == key && num_moves < MAX_MOVES; i++) {
+        const struct Explorer_entry *entry = &explorer->entries[i];
+
+        // Colliding keys could give anything
+        for (int j = 0; j < num_legal_moves; j++) {
+            if (encode_move(legal_moves[j]) == entry->move) {
+                moves[num_moves++] = (struct Explorer_move) {
+                    legal_moves[j], entry->white_wins + entry->draws + entry->black_wins,
+                    entry->white_wins, entry->draws, entry->black_wins
+                };
+                break;
+            }
+        }
+    }
+
+    qsort(moves, num_moves, sizeof(struct Explorer_move), _compare_explorer_moves);
+    return num_moves;
+}
+
+/*** Functions ***/
+
+int build_explorer(const char* db_path, const char* index_path, int max_ply, int num_threads, struct Explorer_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Explorer_stats));
+
+    struct Db db;
+    if ( !db_open(&db, db_path) )
+        return 0;
+
+    // Read front to back after all
+    madvise((void*)db.data, db.size, MADV_SEQUENTIAL);
+
+    int num_chunks = (db.num_games + explorer_chunk_games - 1) / explorer_chunk_games;
+    struct Explorer_chunk *chunks = calloc(num_chunks ? num_chunks : 1, sizeof(struct Explorer_chunk));
+
+    for (int i = 0; i < num_chunks; i++) {
+        chunks[i].first_game = i * explorer_chunk_games;
+        chunks[i].num_games = (db.num_games - chunks[i].first_game < explorer_chunk_games)
+            ? db.num_games - chunks[i].first_game : explorer_chunk_games;
+    }
+
+    struct Explorer_job job = { &db, chunks, max_ply };
+    parallel_for(num_chunks, num_threads, _explore_chunk, &job);
+
+    uint64_t num_entries = 0;
+    for (int i = 0; i < num_chunks; i++)
+        num_entries += chunks[i].num_entries;
+
+    struct Explorer_entry *entries = malloc(sizeof(struct Explorer_entry) * (num_entries ? num_entries : 1));
+    num_entries = 0;
+
+    for (int i = 0; i < num_chunks; i++) {
+        memcpy(&entries[num_entries], chunks[i].entries, sizeof(struct Explorer_entry) * chunks[i].num_entries);
+        num_entries += chunks[i].num_entries;
+        stats->games += chunks[i].games;
+        free(chunks[i].entries);
+    }
+
+    free(chunks);
+    db_close(&db);
+
+    num_entries = _merge_explorer_entries(entries, num_entries);
+
+    for (uint64_t i = 0; i < num_entries; i++)
+        stats->positions += (i == 0 || entries[i].key != entries[i-1].key);
+
+    struct Explorer_header header = { {0}, explorer_version, max_ply, stats->games, num_entries };
+    memcpy(header.magic, explorer_magic, sizeof(explorer_magic));
+
+    int ret = 0;
+    FILE *file = fopen(index_path, "wb");
+
+    if (file != NULL) {
+        ret = fwrite(&header, sizeof(header), 1, file) == 1;
+        ret = ret && fwrite(entries, sizeof(struct Explorer_entry), num_entries, file) == num_entries;
+        ret = (fclose(file) == 0) && ret;
+    }
+
+    if (!ret)
+        log_msg("Error in build_explorer(): could not write index", error);
+
+    stats->entries = num_entries;
+    free(entries);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Opening explorer: for every position of a game database up to some ply, how often each
+* move was played and how those games ended.
+*
+* Index files, version 1, host byte order like the database:
+*
+*   struct Explorer_header
+*   struct Explorer_entry[num_entries]     sorted by key, then move
+*/
+struct Explorer_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_ply;
+    uint64_t num_games;
+    uint64_t num_entries;
+};
+
+struct Explorer_entry {
+    // hash_position() of the position the move is played in
+    uint64_t key;
+
+    // encode_move()
+    uint16_t move;
+    uint16_t reserved;
+
+    uint32_t white_wins;
+    uint32_t draws;
+    uint32_t black_wins;
+};
+
+/*
+* An open, memory-mapped index
+*/
+struct Explorer {
+    const char *data;
+    size_t size;
+
+    const struct Explorer_header *header;
+    const struct Explorer_entry *entries;
+    uint64_t num_entries;
+};
+
+struct Explorer_move {
+    struct Move move;
+
+    uint32_t games;
+    uint32_t white_wins;
+    uint32_t draws;
+    uint32_t black_wins;
+};
+
+struct Explorer_stats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t entries;
+    double seconds;
+};
+
+/*
+* returns: success of operation
+*/
+int explorer_open(struct Explorer* explorer, const char* path);
+void explorer_close(struct Explorer* explorer);
+
+/*
+* Find the moves played in pos by binary search, most played first, at most MAX_MOVES
+* returns: number of moves
+*/
+int explorer_probe(const struct Explorer* explorer, struct Position* pos, struct Explorer_move* moves);
+
+/*
+* Index the first max_ply halfmoves of all finished games of the database at db_path.
+* Games are replayed on num_threads threads (0 = one per core)
+* returns: success of operation
+*/
+int build_explorer(const char* db_path, const char* index_path, int max_ply, int num_threads, struct Explorer_stats* stats);
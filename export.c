@@ -0,0 +1,211 @@
+/**
+ * @file export.c
+ * @brief Dumping a game database as PGN or FEN
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Games are formatted in chunks by a pool of threads, each into its own buffer. The
+ * buffers are kept for the whole export and written in database order.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "export.h"
+#include "backend.h"
+#include "pgn.h"
+#include "fen.h"
+#include "db.h"
+#include "pool.h"
+#include "main.h"
+
+struct Export_chunk {
+    uint64_t first_game;
+    uint64_t num_games;
+
+    struct Pgn_writer output;
+    uint64_t moves;
+};
+
+struct Export_job {
+    const struct Db *db;
+    int as_fen;
+
+    struct Export_chunk *chunks;
+};
+
+/*** Constants ***/
+
+const uint64_t export_chunk_games = 256;
+const int export_chunks_per_thread = 4;
+
+/*** Formatting ***/
+
+void _export_pgn(const struct Db* db, uint64_t id, struct Pgn_writer* writer) {
+    const char *tag = db->data + db->index[id].offset;
+    const char *end = tag + db->index[id].tags_size;
+    int has_result = 0;
+
+    while (tag < end && *tag != '\0') {
+        const char *value = tag + strlen(tag) + 1;
+
+        pgn_write_raw_tag(writer, tag, value);
+        has_result |= !strcmp(tag, "Result");
+
+        tag = value + strlen(value) + 1;
+    }
+
+    enum Game_state result = db->index[id].result;
+
+    if (!has_result) {
+        switch (result) {
+            case white_win: pgn_write_tag(writer, "Result", "1-0"); break;
+            case black_win: pgn_write_tag(writer, "Result", "0-1"); break;
+            case draw:      pgn_write_tag(writer, "Result", "1/2-1/2"); break;
+            default:        pgn_write_tag(writer, "Result", "*"); break;
+        }
+    }
+
+    int num_moves;
+    const uint16_t *moves = db_game_moves(db, id, &num_moves);
+
+    struct Position positions[2];
+    positions[0] = starting_position;
+
+    for (int i = 0; i < num_moves; i++) {
+        struct Position *crnt_pos = &positions[i % 2];
+        struct Move move = decode_move(moves[i], crnt_pos->state);
+
+        pgn_write_move(writer, crnt_pos, move);
+        unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+    }
+
+    pgn_write_result(writer, result);
+}
+
+void _export_fen(const struct Db* db, uint64_t id, struct Pgn_writer* writer) {
+    int num_moves;
+    const uint16_t *moves = db_game_moves(db, id, &num_moves);
+
+    struct Position positions[2];
+    positions[0] = starting_position;
+    char fen[129];
+
+    for (int i = 0; i <= num_moves; i++) {
+        struct Position *crnt_pos = &positions[i % 2];
+
+        int length = write_fen(crnt_pos, i/2 + 1, fen);
+        fen[length++] = '\n';
+        pgn_write_raw(writer, fen, length);
+
+        if (i == num_moves)
+            break;
+
+        struct Move move = decode_move(moves[i], crnt_pos->state);
+        unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+    }
+}
+
+void _export_chunk(int index, void* data) {
+    struct Export_job *job = data;
+    struct Export_chunk *chunk = &job->chunks[index];
+
+    chunk->moves = 0;
+
+    for (uint64_t id = chunk->first_game; id < chunk->first_game + chunk->num_games; id++) {
+        if ( !db_has_game(job->db, id) ) {
+            log_msg("Error in export_db(): left out a corrupt game", error);
+            continue;
+        }
+
+        if (job->as_fen)
+            _export_fen(job->db, id, &chunk->output);
+        else
+            _export_pgn(job->db, id, &chunk->output);
+
+        chunk->moves += job->db->index[id].num_moves;
+    }
+}
+
+/*** Functions ***/
+
+int export_db(const char* db_path, const char* out_path, int num_threads, struct Export_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Export_stats));
+
+    if (num_threads <= 0)
+        num_threads = num_cores();
+
+    struct Db db;
+    if ( !db_open(&db, db_path) )
+        return 0;
+
+    FILE *out = fopen(out_path, "w");
+    if (out == NULL) {
+        log_msg("Error in export_db(): could not open output file", error);
+        db_close(&db);
+        return 0;
+    }
+
+    size_t path_length = strlen(out_path);
+    int as_fen = path_length >= 4 && !strcmp(out_path + path_length - 4, ".fen");
+
+    log_msg("(export) Exporting database", log_info);
+
+    int batch_size = num_threads * export_chunks_per_thread;
+    struct Export_chunk *chunks = calloc(batch_size, sizeof(struct Export_chunk));
+    struct Export_job job = { &db, as_fen, chunks };
+
+    for (int i = 0; i < batch_size; i++)
+        pgn_writer_open(&chunks[i].output, NULL);
+
+    int ret = 1;
+    uint64_t id = 0;
+
+    while (id < db.num_games) {
+        int num_chunks = 0;
+
+        for (; num_chunks < batch_size && id < db.num_games; num_chunks++) {
+            chunks[num_chunks].first_game = id;
+            chunks[num_chunks].num_games = db.num_games - id < export_chunk_games ? db.num_games - id : export_chunk_games;
+            id += chunks[num_chunks].num_games;
+        }
+
+        parallel_for(num_chunks, num_threads, _export_chunk, &job);
+
+        for (int i = 0; i < num_chunks; i++) {
+            struct Pgn_writer *output = &chunks[i].output;
+
+            ret = ret && fwrite(output->buffer, 1, output->size, out) == output->size;
+
+            stats->games += chunks[i].num_games;
+            stats->moves += chunks[i].moves;
+            stats->bytes += output->size;
+
+            // Keep the buffer for the next batch
+            output->size = 0;
+        }
+    }
+
+    for (int i = 0; i < batch_size; i++)
+        pgn_writer_close(&chunks[i].output);
+    free(chunks);
+
+    ret = (fclose(out) == 0) && ret;
+    db_close(&db);
+
+    if (!ret)
+        log_msg("Error in export_db(): could not write output file", error);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
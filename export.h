@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Export_stats {
+    uint64_t games;
+    uint64_t moves;
+    uint64_t bytes;
+
+    double seconds;
+};
+
+/*
+* Write all games of a database as PGN, or every position of every game as one FEN per
+* line if out_path ends in ".fen". Formatting runs on num_threads threads (0 = one per
+* core), output keeps the order of the database
+* returns: success of operation
+*/
+int export_db(const char* db_path, const char* out_path, int num_threads, struct Export_stats* stats);
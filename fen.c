@@ -0,0 +1,200 @@
+/**
+ * @file fen.c
+ * @brief Converting positions to and from Forsyth-Edwards notation
+ * @version 1.0
+ * @date 19.10.2026
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fen.h"
+#include "backend.h"
+
+/*** Constants ***/
+
+// Indexed by enum Piece
+const char fen_piece[] = " PPNBRQKppnbrqk";
+
+/*** Writing ***/
+
+int write_fen(const struct Position* pos, int fullmove, char fen[128]) {
+    int length = 0;
+    int en_passant = -1;
+
+    for (int y = 7; y >= 0; y--) {
+        int empty = 0;
+
+        for (int x = 0; x < 8; x++) {
+            enum Piece piece = pos->board[x + 8*y];
+
+            if (piece == o) {
+                empty++;
+                continue;
+            }
+
+            if (empty > 0)
+                fen[length++] = '0' + empty;
+            empty = 0;
+
+            fen[length++] = fen_piece[piece];
+
+            // Square behind a pawn that just moved two squares
+            if (piece == P_passant)
+                en_passant = x + 8*(y-1);
+            else if (piece == p_passant)
+                en_passant = x + 8*(y+1);
+        }
+
+        if (empty > 0)
+            fen[length++] = '0' + empty;
+        if (y > 0)
+            fen[length++] = '/';
+    }
+
+    // Finished games: the side that has been mated is to move
+    int black_to_move = pos->state == black || pos->state == white_win;
+
+    fen[length++] = ' ';
+    fen[length++] = black_to_move ? 'b' : 'w';
+    fen[length++] = ' ';
+
+    if (pos->white_can_castle_king)     fen[length++] = 'K';
+    if (pos->white_can_castle_queen)    fen[length++] = 'Q';
+    if (pos->black_can_castle_king)     fen[length++] = 'k';
+    if (pos->black_can_castle_queen)    fen[length++] = 'q';
+    if (fen[length-1] == ' ')           fen[length++] = '-';
+
+    fen[length++] = ' ';
+    if (en_passant >= 0) {
+        fen[length++] = 'a' + en_passant % 8;
+        fen[length++] = '1' + en_passant / 8;
+    }
+    else
+        fen[length++] = '-';
+
+    length += snprintf(fen + length, 128 - length, " %d %d", pos->halfmove_clock, fullmove);
+    return length;
+}
+
+/*** Reading ***/
+
+int _skip_spaces(const char* fen, int i) {
+    while (fen[i] == ' ' || fen[i] == '\t')
+        i++;
+    return i;
+}
+
+int read_fen(const char* fen, struct Position* pos, int* fullmove) {
+    memset(pos, 0, sizeof(struct Position));
+
+    int i = _skip_spaces(fen, 0);
+    int x = 0, y = 7;
+    int kings[2] = {0, 0};
+
+    // Board
+    for (; fen[i] != ' ' && fen[i] != '\0'; i++) {
+        char c = fen[i];
+
+        if (c == '/') {
+            if (x != 8 || y == 0)
+                return 0;
+            x = 0;
+            y--;
+        }
+
+        else if ('1' <= c && c <= '8')
+            x += c - '0';
+
+        else {
+            const char *piece = strchr(fen_piece + 1, c);
+            if (c == '\0' || piece == NULL || x >= 8)
+                return 0;
+
+            pos->board[x + 8*y] = piece - fen_piece;
+            kings[0] += c == 'K';
+            kings[1] += c == 'k';
+            x++;
+        }
+
+        if (x > 8)
+            return 0;
+    }
+
+    if (x != 8 || y != 0 || kings[0] != 1 || kings[1] != 1)
+        return 0;
+
+    // Side to move
+    i = _skip_spaces(fen, i);
+    if (fen[i] == 'w')
+        pos->state = white;
+    else if (fen[i] == 'b')
+        pos->state = black;
+    else
+        return 0;
+    i++;
+
+    // Castling rights
+    i = _skip_spaces(fen, i);
+    for (; fen[i] != ' ' && fen[i] != '\0'; i++) {
+        switch (fen[i]) {
+            case 'K': pos->white_can_castle_king = 1; break;
+            case 'Q': pos->white_can_castle_queen = 1; break;
+            case 'k': pos->black_can_castle_king = 1; break;
+            case 'q': pos->black_can_castle_queen = 1; break;
+            case '-': break;
+            default: return 0;
+        }
+    }
+
+    // En passant: flag the pawn that just moved two squares
+    i = _skip_spaces(fen, i);
+    if (fen[i] == '-')
+        i++;
+
+    else if ('a' <= fen[i] && fen[i] <= 'h' && (fen[i+1] == '3' || fen[i+1] == '6')) {
+        int file = fen[i] - 'a';
+
+        if (fen[i+1] == '3' && pos->board[file + 24] == P)
+            pos->board[file + 24] = P_passant;
+        else if (fen[i+1] == '6' && pos->board[file + 32] == p)
+            pos->board[file + 32] = p_passant;
+
+        i += 2;
+    }
+
+    else
+        return 0;
+
+    // Optional halfmove clock and move number
+    int end = _skip_spaces(fen, i);
+    int counters[2] = {0, 1};
+
+    for (int j = 0; j < 2; j++) {
+        char *number_end;
+        long number = strtol(fen + end, &number_end, 10);
+
+        if (number_end == fen + end || (*number_end != ' ' && *number_end != '\0' && *number_end != ';'))
+            break;
+
+        counters[j] = number;
+        i = number_end - fen;
+        end = _skip_spaces(fen, i);
+    }
+
+    // Saturating, as in unsafe_play_move_to()
+    if (counters[0] < 0)
+        counters[0] = 0;
+    if (counters[0] > UINT8_MAX)
+        counters[0] = UINT8_MAX;
+
+    pos->halfmove_clock = counters[0];
+
+    if (fullmove != NULL)
+        *fullmove = counters[1] > 0 ? counters[1] : 1;
+
+    return i;
+}
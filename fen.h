@@ -0,0 +1,16 @@
+#pragma once
+
+#include "backend.h"
+
+/*
+* Write pos in Forsyth-Edwards notation. fullmove is the move number, starting at 1
+* returns: length of fen
+*/
+int write_fen(const struct Position* pos, int fullmove, char fen[128]);
+
+/*
+* Read a position in Forsyth-Edwards notation. The move counters are optional, fullmove
+* may be NULL
+* returns: number of characters read, 0 if fen is malformed
+*/
+int read_fen(const char* fen, struct Position* pos, int* fullmove);
@@ -0,0 +1,216 @@
+/**
+ * @file import.c
+ * @brief Bulk conversion of PGN files into a game database
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * The PGN file is cut into shards at game boundaries. Shards are replayed in parallel,
+ * batch by batch, and written to the database in their original order.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "import.h"
+#include "backend.h"
+#include "pgn.h"
+#include "db.h"
+#include "pool.h"
+#include "main.h"
+
+struct Import_shard {
+    const char *data;
+    size_t size;
+
+    struct Db_buffer output;
+
+    uint64_t games;
+    uint64_t moves;
+    uint64_t failed_games;
+};
+
+/*** Constants ***/
+
+const size_t import_shard_size = 8 << 20;
+
+// Shards replayed before writing them out, per thread
+const int import_shards_per_thread = 4;
+
+/*** Sharding ***/
+
+/*
+* returns: offset of the first game starting at or after offset
+*/
+size_t _find_game_boundary(const char* data, size_t size, size_t offset) {
+    const char *end = data + size;
+    const char *p = data + offset;
+
+    while (p < end) {
+        const char *line = memchr(p, '\n', end - p);
+        if (line == NULL)
+            return size;
+        line++;
+        p = line;
+
+        if (line == end || *line != '[')
+            continue;
+
+        // A tag directly following another tag belongs to the same game
+        const char *prev = line-1;
+        while (prev > data && (prev[-1] == '\n' || prev[-1] == '\r' || prev[-1] == ' '))
+            prev--;
+        while (prev > data && prev[-1] != '\n')
+            prev--;
+
+        if (*prev != '[')
+            return line - data;
+    }
+
+    return size;
+}
+
+/*** Replaying ***/
+
+int _import_game(struct Pgn_game* game, uint16_t** moves, int* moves_capacity) {
+    // Records have no room for a starting position
+    if (pgn_find_tag(game, "FEN") != NULL)
+        return 0;
+
+    if (game->num_moves > *moves_capacity) {
+        *moves_capacity = 2*game->num_moves;
+        *moves = realloc(*moves, sizeof(uint16_t) * *moves_capacity);
+    }
+
+    struct Position positions[2];
+    positions[0] = starting_position;
+    char string[16];
+
+    for (int i = 0; i < game->num_moves; i++) {
+        struct Position *crnt_pos = &positions[i % 2];
+        struct Move move;
+
+        if ( !pgn_move_string(&game->moves[i], string) )
+            return 0;
+
+        if ( !parse_algebraic(crnt_pos, string, &move) )
+            return 0;
+
+        (*moves)[i] = encode_move(move);
+        unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+    }
+
+    return 1;
+}
+
+void _import_games(struct Pgn_reader* reader, struct Import_shard* shard) {
+    struct Pgn_game game;
+
+    uint16_t *moves = NULL;
+    int moves_capacity = 0;
+
+    while (pgn_next_game(reader, &game)) {
+        if ( !_import_game(&game, &moves, &moves_capacity) ) {
+            shard->failed_games++;
+            continue;
+        }
+
+        db_buffer_add_game(&shard->output, game.tags, game.num_tags, moves, game.num_moves, game.result);
+        shard->games++;
+        shard->moves += game.num_moves;
+    }
+
+    free(moves);
+}
+
+void _import_shard(int index, void* data) {
+    struct Import_shard *shard = &((struct Import_shard*)data)[index];
+    struct Pgn_reader reader;
+
+    pgn_open_memory(&reader, shard->data, shard->size);
+    _import_games(&reader, shard);
+    pgn_close(&reader);
+}
+
+int _write_shard(struct Db_writer* writer, struct Import_shard* shard, struct Import_stats* stats) {
+    int ret = db_write_buffer(writer, &shard->output);
+
+    stats->games += shard->games;
+    stats->moves += shard->moves;
+    stats->failed_games += shard->failed_games;
+
+    delete_db_buffer(&shard->output);
+    return ret;
+}
+
+/*** Functions ***/
+
+int import_pgn(const char* pgn_path, const char* db_path, int num_threads, struct Import_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Import_stats));
+
+    if (num_threads <= 0)
+        num_threads = num_cores();
+
+    struct Pgn_reader reader;
+    struct Db_writer writer;
+
+    if ( !pgn_open(&reader, pgn_path) )
+        return 0;
+
+    if ( !db_create(&writer, db_path) ) {
+        pgn_close(&reader);
+        return 0;
+    }
+
+    log_msg("(import) Importing pgn file", log_info);
+    int ret = 1;
+
+    // Streams cannot be sharded
+    if (!reader.is_mapped) {
+        struct Import_shard shard = {0};
+        _import_games(&reader, &shard);
+        ret = _write_shard(&writer, &shard, stats);
+    }
+
+    else {
+        int batch_size = num_threads * import_shards_per_thread;
+        struct Import_shard *shards = malloc(sizeof(struct Import_shard) * batch_size);
+        size_t offset = 0;
+
+        while (offset < reader.size) {
+            int num_shards = 0;
+
+            for (; num_shards < batch_size && offset < reader.size; num_shards++) {
+                size_t end = offset + import_shard_size;
+                end = (end >= reader.size) ? reader.size : _find_game_boundary(reader.data, reader.size, end);
+
+                memset(&shards[num_shards], 0, sizeof(struct Import_shard));
+                shards[num_shards].data = reader.data + offset;
+                shards[num_shards].size = end - offset;
+                offset = end;
+            }
+
+            parallel_for(num_shards, num_threads, _import_shard, shards);
+
+            for (int i = 0; i < num_shards; i++)
+                ret = _write_shard(&writer, &shards[i], stats) && ret;
+        }
+
+        free(shards);
+    }
+
+    ret = db_finish(&writer) && ret;
+    pgn_close(&reader);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
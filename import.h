@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Import_stats {
+    uint64_t games;
+    uint64_t moves;
+    uint64_t failed_games;
+
+    double seconds;
+};
+
+/*
+* Convert all games of a PGN file into a game database, replaying them on num_threads
+* threads (0 = one per core). Games with illegal moves are skipped and counted in
+* failed_games, like games with a FEN tag: the database stores every game from
+* starting_position, other starts are not supported by design
+* returns: success of operation
+*/
+int import_pgn(const char* pgn_path, const char* db_path, int num_threads, struct Import_stats* stats);
@@ -0,0 +1,229 @@
+/**
+ * @file log.c
+ * @brief Logging into log.txt without blocking the caller
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Messages are copied into a bounded lock-free queue (multiple producers, one consumer)
+ * and written by a background thread, which keeps the log file open and rotates it
+ * once it grows too large. If the queue is full, messages are dropped and counted,
+ * except for errors, which wait for the writer.
+ */
+
+/*** Definitions ***/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "log.h"
+
+#define LOG_QUEUE_SIZE 4096
+#define LOG_MESSAGE_SIZE 240
+
+struct Log_slot {
+    atomic_size_t sequence;
+
+    time_t time;
+    enum Verbosity type;
+    char msg[LOG_MESSAGE_SIZE];
+};
+
+/*** Constants ***/
+
+const char *log_path = "log.txt";
+const char *log_rotated_path = "log.txt.1";
+
+const long log_max_size = 8 << 20;
+
+// Sleep of the writer when there is nothing to write
+const long log_idle_ns = 5000000;
+
+/*** State ***/
+
+struct Log_slot log_queue[LOG_QUEUE_SIZE];
+atomic_size_t log_enqueue_position;
+size_t log_dequeue_position;
+
+atomic_ulong log_dropped;
+atomic_int log_running;
+
+pthread_once_t log_once = PTHREAD_ONCE_INIT;
+pthread_t log_thread;
+
+FILE *log_file;
+long log_size;
+
+/*** Background writer ***/
+
+void _open_log_file() {
+    log_file = fopen(log_path, "a");
+    log_size = log_file ? ftell(log_file) : 0;
+}
+
+void _rotate_log_file() {
+    fclose(log_file);
+    rename(log_path, log_rotated_path);
+    _open_log_file();
+}
+
+/*
+* Write all queued messages
+* returns: number of messages written
+*/
+int _drain_log() {
+    static time_t last_time = -1;
+    static char timestamp[32];
+
+    int written = 0;
+
+    for (;;) {
+        struct Log_slot *slot = &log_queue[log_dequeue_position % LOG_QUEUE_SIZE];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+        if (sequence != log_dequeue_position + 1)
+            break;
+
+        // Formatting the time is only needed once per second
+        if (slot->time != last_time) {
+            struct tm tm;
+            localtime_r(&slot->time, &tm);
+            strftime(timestamp, sizeof(timestamp), "%d.%m.%Y %H:%M:%S", &tm);
+            last_time = slot->time;
+        }
+
+        const char *prefix = "";
+        switch (slot->type) {
+            case verbose:   prefix = "verbose"; break;
+            case log_info:  prefix = "  log  "; break;
+            case error:     prefix = " error "; break;
+        }
+
+        if (log_file != NULL)
+            log_size += fprintf(log_file, "[%s] [%s]: %s\n", prefix, timestamp, slot->msg);
+
+        atomic_store_explicit(&slot->sequence, log_dequeue_position + LOG_QUEUE_SIZE, memory_order_release);
+        log_dequeue_position++;
+        written++;
+    }
+
+    unsigned long dropped = atomic_exchange(&log_dropped, 0);
+    if (dropped > 0 && log_file != NULL)
+        log_size += fprintf(log_file, "[ error ] [%s]: %lu messages dropped, log queue was full\n", timestamp, dropped);
+
+    if (log_file != NULL) {
+        fflush(log_file);
+
+        if (log_size > log_max_size)
+            _rotate_log_file();
+    }
+
+    return written;
+}
+
+void* _log_writer(void* arg) {
+    (void)arg;
+    struct timespec idle = { 0, log_idle_ns };
+
+    while (atomic_load(&log_running)) {
+        if (_drain_log() == 0)
+            nanosleep(&idle, NULL);
+    }
+
+    _drain_log();
+    return NULL;
+}
+
+void _start_log() {
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+        atomic_init(&log_queue[i].sequence, i);
+
+    _open_log_file();
+
+    atomic_store(&log_running, 1);
+    pthread_create(&log_thread, NULL, _log_writer, NULL);
+
+    atexit(flush_log);
+}
+
+/*** Functions ***/
+
+void init_log() {
+    remove(log_path);
+    remove(log_rotated_path);
+
+    pthread_once(&log_once, _start_log);
+}
+
+void flush_log() {
+    if ( !atomic_exchange(&log_running, 0) )
+        return;
+
+    pthread_join(log_thread, NULL);
+
+    if (log_file != NULL)
+        fclose(log_file);
+    log_file = NULL;
+}
+
+void _log_msg(const char* msg, enum Verbosity type) {
+    pthread_once(&log_once, _start_log);
+
+    // Coarse clock is read without a system call
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+
+    size_t position = atomic_load_explicit(&log_enqueue_position, memory_order_relaxed);
+    struct Log_slot *slot;
+
+    for (;;) {
+        slot = &log_queue[position % LOG_QUEUE_SIZE];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&log_enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+
+        // Full
+        else if (difference < 0) {
+            if (type != error || !atomic_load(&log_running)) {
+                atomic_fetch_add(&log_dropped, 1);
+                return;
+            }
+
+            sched_yield();
+            position = atomic_load_explicit(&log_enqueue_position, memory_order_relaxed);
+        }
+
+        else
+            position = atomic_load_explicit(&log_enqueue_position, memory_order_relaxed);
+    }
+
+    slot->time = now.tv_sec;
+    slot->type = type;
+    strncpy(slot->msg, msg, LOG_MESSAGE_SIZE - 1);
+    slot->msg[LOG_MESSAGE_SIZE - 1] = '\0';
+
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+void _log_printf(enum Verbosity type, const char* format, ...) {
+    char msg[LOG_MESSAGE_SIZE];
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+
+    _log_msg(msg, type);
+}
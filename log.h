@@ -0,0 +1,36 @@
+#pragma once
+
+enum Verbosity {
+    verbose,
+    log_info,
+    error
+};
+
+/*
+* Messages below LOG_LEVEL are removed at compile time, arguments are not even evaluated.
+* Build with -DLOG_LEVEL=0 to get verbose messages
+*/
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 1
+#endif
+
+#define log_enabled(type) ((type) >= LOG_LEVEL)
+
+#define log_msg(msg, type) \
+    do { if (log_enabled(type)) _log_msg((msg), (type)); } while (0)
+
+#define log_printf(type, ...) \
+    do { if (log_enabled(type)) _log_printf((type), __VA_ARGS__); } while (0)
+
+/*
+* Remove the old log and start the background writer
+*/
+void init_log();
+
+/*
+* Write all queued messages and stop the background writer. Called at exit
+*/
+void flush_log();
+
+void _log_msg(const char* msg, enum Verbosity type);
+void _log_printf(enum Verbosity type, const char* format, ...);
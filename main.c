@@ -2,9 +2,10 @@
  * @file main.c
  * @author Yannnick Zickler
  * @brief A C implementation of the game of chess, consisting of
- *      1. main.c,      implementing main() and logging;
- *      2. tui.c,       implementing the text-based graphical user interface; and
- *      3. backend.c,   implementing the actual game of chess.
+ *      1. main.c,      implementing main() and the headless commands;
+ *      2. tui.c,       implementing the text-based graphical user interface;
+ *      3. backend.c,   implementing the actual game of chess; and
+ *      4. pgn.c,       reading games from PGN files.
  * @version 1.1
  * @date 1.9.2025
  *
@@ -21,46 +22,671 @@
 #include "tui.h"
 #include "backend.h"
 #include "engine.h"
+#include "db.h"
+#include "import.h"
+#include "export.h"
+#include "epd.h"
+#include "fen.h"
+#include "bench.h"
+#include "book.h"
+#include "tb.h"
+#include "nnue.h"
+#include "tune.h"
+#include "match.h"
+#include "datagen.h"
+#include "analyze.h"
+#include "explorer.h"
+#include "posindex.h"
 
+/*** Commands ***/
 
-const enum Verbosity verbosity = verbose;
+int command_import(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s import <games.pgn> <games.db> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    int num_threads = (argc > 4) ? atoi(argv[4]) : 0;
+    struct Import_stats stats;
+
+    int ret = import_pgn(argv[2], argv[3], num_threads, &stats);
 
-void init_log() {
-    remove("log.txt");
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("%llu games, %llu moves, %llu skipped in %.2fs (%.0f games/s, %.0f moves/s)\n",
+        (unsigned long long)stats.games, (unsigned long long)stats.moves, (unsigned long long)stats.failed_games,
+        stats.seconds, stats.games / seconds, stats.moves / seconds
+    );
+
+    return !ret;
 }
 
-void log_msg(char *msg, enum Verbosity type) {
-    if (type < verbosity)
-        return;
+int command_export(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s export <games.db> <games.pgn|positions.fen> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    int num_threads = (argc > 4) ? atoi(argv[4]) : 0;
+    struct Export_stats stats;
+
+    int ret = export_db(argv[2], argv[3], num_threads, &stats);
 
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("%llu games, %llu moves, %.1f MB in %.2fs (%.0f games/s, %.1f MB/s)\n",
+        (unsigned long long)stats.games, (unsigned long long)stats.moves, stats.bytes / 1e6,
+        stats.seconds, stats.games / seconds, stats.bytes / 1e6 / seconds
+    );
 
-    char prefix[8];
+    return !ret;
+}
 
-    switch(type) {
-        case verbose:   strcpy(prefix, "verbose"); break;
-        case log:       strcpy(prefix, "  log  "); break;
-        case error:     strcpy(prefix, " error "); break;
+/*
+* Parse a search limit of the form time=ms, nodes=n or depth=d
+* returns: success of operation
+*/
+int parse_limit(const char* s, struct Search_limits* limits) {
+    return (
+        sscanf(s, "time=%d", &limits->time_ms) == 1 ||
+        sscanf(s, "nodes=%llu", (unsigned long long*)&limits->nodes) == 1 ||
+        sscanf(s, "depth=%d", &limits->depth) == 1
+    );
+}
+
+int command_epd(int argc, char** argv) {
+    struct Search_limits limits = {0};
+
+    if (argc < 4 || !parse_limit(argv[3], &limits)) {
+        fprintf(stderr, "usage: %s epd <suite.epd> <time=ms | nodes=n | depth=d> [threads]\n", argv[0]);
+        return 1;
     }
 
-    FILE *f = fopen("log.txt", "a");
+    int num_threads = (argc > 4) ? atoi(argv[4]) : 0;
+    struct Epd_stats stats;
+
+    int ret = run_epd_suite(argv[2], &limits, num_threads, &stats);
 
-    // Append some text to the file
-    fprintf(f,
-        "[%s] [%02d.%02d.%d %02d:%02d:%02d]: %s\n", 
-        prefix,
-        tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
-        msg
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("solved %d/%d, average time to solution %.3fs, %llu nodes in %.2fs (%.0f nps)\n",
+        stats.solved, stats.positions, stats.solved ? stats.time_to_solution / stats.solved : 0.0,
+        (unsigned long long)stats.nodes, stats.seconds, stats.nodes / seconds
     );
 
-    fclose(f); 
+    return !ret;
+}
+
+void _print_iteration(const struct Search_result* result, void* data) {
+    print_uci_info(stdout, data, result);
+}
+
+int command_search(int argc, char** argv) {
+    struct Search_limits limits = {0};
+    struct Position pos = starting_position;
+
+    if (
+        argc < 4 || !parse_limit(argv[3], &limits) ||
+        (strcmp(argv[2], "startpos") && read_fen(argv[2], &pos, NULL) == 0)
+    ) {
+        fprintf(stderr, "usage: %s search <fen | startpos> <time=ms | nodes=n | depth=d> [multipv=k] [stats.json]\n", argv[0]);
+        return 1;
+    }
+
+    // The number of lines comes before the optional statistics file
+    int json_arg = 4;
+    if (argc > 4 && sscanf(argv[4], "multipv=%d", &limits.multi_pv) == 1)
+        json_arg++;
+
+    struct Transposition_table tt;
+    struct Search_result result;
+
+    init_tt(&tt, 64);
+    load_engine_files();
+    limits.on_iteration = _print_iteration;
+    limits.data = &pos;
+
+    search(&pos, &limits, &tt, &result);
+    delete_tt(&tt);
+
+    char move[8];
+    write_uci_move(result.best_move, move);
+    printf("bestmove %s\n", move);
+
+    if (argc > json_arg) {
+        FILE *file = fopen(argv[json_arg], "w");
+        if (file == NULL) {
+            fprintf(stderr, "could not open %s\n", argv[json_arg]);
+            return 1;
+        }
+
+        print_search_json(file, &pos, &result);
+        fclose(file);
+    }
+
+    else
+        print_search_json(stderr, &pos, &result);
+
+    return 0;
+}
+
+int command_bench(int argc, char** argv) {
+    int depth = (argc > 2) ? atoi(argv[2]) : bench_default_depth;
+
+    if (depth <= 0 || depth > MAX_PLY) {
+        fprintf(stderr, "usage: %s bench [depth]\n", argv[0]);
+        return 1;
+    }
+
+    struct Bench_stats stats;
+    int ret = run_bench(depth, &stats);
+
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("===========================\n");
+    printf("Positions: %d\nDepth    : %d\nTime (ms): %.0f\nNodes    : %llu\nNPS      : %.0f\n",
+        stats.positions, depth, stats.seconds * 1000, (unsigned long long)stats.nodes, stats.nodes / seconds
+    );
+
+    return !ret;
+}
+
+int command_book(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[2], "probe")) {
+        struct Position pos = starting_position;
+        struct Book book;
+
+        if (argc > 4 && strcmp(argv[4], "startpos") && read_fen(argv[4], &pos, NULL) == 0) {
+            fprintf(stderr, "malformed fen\n");
+            return 1;
+        }
+
+        if ( !book_open(&book, argv[3]) ) {
+            fprintf(stderr, "could not open %s\n", argv[3]);
+            return 1;
+        }
+
+        struct Book_move moves[MAX_MOVES];
+        int num_moves = book_probe(&book, &pos, moves);
+
+        struct Move legal_moves[MAX_MOVES];
+        int num_legal_moves = gen_move_list(&pos, legal_moves);
+
+        printf("key %016llx, %d book moves\n", (unsigned long long)polyglot_hash(&pos), num_moves);
+
+        for (int i = 0; i < num_moves; i++) {
+            char san[16];
+            write_algebraic(&pos, legal_moves, num_legal_moves, moves[i].move, san);
+            printf("%-8s %5d\n", san, moves[i].weight);
+        }
+
+        book_close(&book);
+        return 0;
+    }
+
+    if (argc >= 5 && !strcmp(argv[2], "build")) {
+        int max_ply = (argc > 5) ? atoi(argv[5]) : 24;
+        struct Book_stats stats;
+
+        int ret = build_book(argv[3], argv[4], max_ply, &stats);
+
+        printf("%llu games, %llu positions, %llu moves in %.2fs\n",
+            (unsigned long long)stats.games, (unsigned long long)stats.positions,
+            (unsigned long long)stats.entries, stats.seconds
+        );
+
+        return !ret;
+    }
+
+    fprintf(stderr, "usage: %s book build <games.pgn> <book.bin> [plies]\n", argv[0]);
+    fprintf(stderr, "       %s book probe <book.bin> [fen | startpos]\n", argv[0]);
+    return 1;
 }
 
+int command_tb(int argc, char** argv) {
+    if (argc >= 5 && !strcmp(argv[2], "probe")) {
+        struct Position pos;
+
+        if (read_fen(argv[4], &pos, NULL) == 0) {
+            fprintf(stderr, "malformed fen\n");
+            return 1;
+        }
+
+        if (tb_init(argv[3]) == 0) {
+            fprintf(stderr, "no tables in %s\n", argv[3]);
+            return 1;
+        }
+
+        const char *results[3] = { "loss", "draw", "win" };
+        int wdl, dtm;
+
+        if ( !tb_probe(&pos, &wdl, &dtm) ) {
+            printf("not found\n");
+            return 0;
+        }
+
+        printf("%s, mate in %d halfmoves\n", results[wdl + 1], dtm);
+
+        struct Move moves[MAX_MOVES];
+        int num_moves = gen_move_list(&pos, moves);
+
+        for (int i = 0; i < num_moves; i++) {
+            struct Position new_pos;
+            unsafe_play_move_to(&pos, &new_pos, moves[i].from, moves[i].to, moves[i].promote);
+
+            char san[16];
+            write_algebraic(&pos, moves, num_moves, moves[i], san);
+
+            // From the point of view of the side playing the move
+            if ( tb_probe(&new_pos, &wdl, &dtm) )
+                printf("%-8s %s %d\n", san, results[1 - wdl], wdl ? dtm + 1 : 0);
+            else
+                printf("%-8s -\n", san);
+        }
+
+        return 0;
+    }
+
+    if (argc >= 4 && !strcmp(argv[2], "generate")) {
+        int num_threads = 0;
+        int first_name = 4;
+
+        if (argc > 4 && argv[4][0] >= '0' && argv[4][0] <= '9')
+            num_threads = atoi(argv[first_name++]);
+
+        struct Tb_stats stats;
+        int ret = tb_generate(argv[3], (const char**)&argv[first_name], argc - first_name, num_threads, &stats);
+
+        printf("%d tables, %llu positions in %.2fs, longest mate %d halfmoves (%s)\n",
+            stats.tables, (unsigned long long)stats.positions, stats.seconds,
+            stats.longest_mate, stats.tables ? stats.longest_mate_table : "-"
+        );
+
+        return !ret;
+    }
+
+    fprintf(stderr, "usage: %s tb generate <dir> [threads] [table ...]\n", argv[0]);
+    fprintf(stderr, "       %s tb probe <dir> <fen>\n", argv[0]);
+    return 1;
+}
+
+int command_nnue(int argc, char** argv) {
+    if (argc >= 4 && !strcmp(argv[2], "init"))
+        return !nnue_write_material_net(argv[3]);
+
+    if (argc >= 4 && !strcmp(argv[2], "eval")) {
+        struct Position pos = starting_position;
+
+        if (argc > 4 && strcmp(argv[4], "startpos") && read_fen(argv[4], &pos, NULL) == 0) {
+            fprintf(stderr, "malformed fen\n");
+            return 1;
+        }
+
+        if ( !nnue_load(argv[3]) ) {
+            fprintf(stderr, "could not load %s\n", argv[3]);
+            return 1;
+        }
+
+        printf("network %d, static %d\n", nnue_eval(&pos), static_eval(&pos));
+        return 0;
+    }
+
+    if (argc >= 4 && !strcmp(argv[2], "check")) {
+        int num_playouts = (argc > 4) ? atoi(argv[4]) : 1000;
+        uint64_t num_positions;
+
+        if ( !nnue_load(argv[3]) ) {
+            fprintf(stderr, "could not load %s\n", argv[3]);
+            return 1;
+        }
+
+        uint64_t mismatches = nnue_check(num_playouts, 200, 1, &num_positions);
+        printf("%llu positions, %llu mismatches\n", (unsigned long long)num_positions, (unsigned long long)mismatches);
+        return mismatches != 0;
+    }
+
+    fprintf(stderr, "usage: %s nnue init <net.nnue>\n", argv[0]);
+    fprintf(stderr, "       %s nnue eval <net.nnue> [fen | startpos]\n", argv[0]);
+    fprintf(stderr, "       %s nnue check <net.nnue> [playouts]\n", argv[0]);
+    return 1;
+}
+
+int command_tune(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s tune <games.pgn | positions.epd> <out.params> [iterations] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    int iterations = (argc > 4) ? atoi(argv[4]) : 1000;
+    int num_threads = (argc > 5) ? atoi(argv[5]) : 0;
+    struct Tune_stats stats;
 
-int main() {
+    int ret = tune_eval(argv[2], argv[3], iterations, num_threads, &stats);
+
+    printf("%llu positions, k %.3f, error %.6f -> %.6f after %d iterations in %.2fs\n",
+        (unsigned long long)stats.positions, stats.k, stats.initial_error, stats.final_error,
+        stats.iterations, stats.seconds
+    );
+
+    return !ret;
+}
+
+int command_match(int argc, char** argv) {
+    struct Match_options options = default_match_options;
+    struct Search_limits limits = {0};
+    double base = 0, increment = 0;
+
+    if (
+        argc < 6 ||
+        (sscanf(argv[5], "tc=%lf+%lf", &base, &increment) < 1 && !parse_limit(argv[5], &limits)) ||
+        (argc > 9 && sscanf(argv[9], "%lf,%lf", &options.elo0, &options.elo1) != 2)
+    ) {
+        fprintf(stderr, "usage: %s match <engine> <engine> <openings.epd | book.bin | startpos> <tc=s+inc | time=ms | nodes=n | depth=d> [games] [threads] [out.pgn] [elo0,elo1]\n", argv[0]);
+        fprintf(stderr, "       engines are \"default\", \"nnue\" or parameter files\n");
+        return 1;
+    }
+
+    options.depth = limits.depth;
+    options.nodes = limits.nodes;
+    options.move_time_ms = limits.time_ms;
+    options.base_ms = base * 1000;
+    options.increment_ms = increment * 1000;
+
+    if (strcmp(argv[4], "startpos"))
+        options.openings_path = argv[4];
+    if (argc > 6)
+        options.games = atoi(argv[6]);
+    if (argc > 7)
+        options.num_threads = atoi(argv[7]);
+    if (argc > 8)
+        options.pgn_path = argv[8];
+
+    load_engine_files();
+
+    struct Match_engine engines[2];
+    for (int i = 0; i < 2; i++) {
+        if ( !load_match_engine(argv[2 + i], &engines[i]) ) {
+            fprintf(stderr, "could not load engine %s\n", argv[2 + i]);
+            return 1;
+        }
+    }
+
+    struct Match_stats stats;
+    int ret = run_match(engines, &options, &stats);
+
+    const char *verdicts[] = { "H0 accepted", "undecided", "H1 accepted" };
+
+    printf("%d games in %.2fs: +%d =%d -%d (%d adjudicated, %d on time), Elo %.1f +- %.1f, LLR %.2f, %s\n",
+        stats.games, stats.seconds, stats.wins, stats.draws, stats.losses, stats.adjudicated, stats.time_losses,
+        stats.elo, stats.elo_error, stats.llr, verdicts[stats.sprt_result + 1]
+    );
+
+    return !ret;
+}
+
+int command_datagen(int argc, char** argv) {
+    struct Search_limits limits = {0};
+
+    if (argc >= 5 && !strcmp(argv[2], "play") && parse_limit(argv[4], &limits) && limits.time_ms == 0) {
+        int games = (argc > 5) ? atoi(argv[5]) : 1000;
+        int num_threads = (argc > 6) ? atoi(argv[6]) : 0;
+        struct Datagen_stats stats;
+
+        load_engine_files();
+        int ret = generate_data(argv[3], limits.nodes, limits.depth, games, num_threads, &stats);
+
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        printf("%llu games, %llu positions, %.1f MB in %.2fs (%.0f positions/s)\n",
+            (unsigned long long)stats.games, (unsigned long long)stats.positions, stats.bytes / 1e6,
+            stats.seconds, stats.positions / seconds
+        );
+
+        return !ret;
+    }
+
+    if (argc >= 4 && !strcmp(argv[2], "read")) {
+        uint64_t count = (argc > 4) ? strtoull(argv[4], NULL, 10) : UINT64_MAX;
+        struct Packed_reader reader;
+        struct Packed_position packed;
+
+        if ( !packed_reader_open(&reader, argv[3]) ) {
+            fprintf(stderr, "could not open %s\n", argv[3]);
+            return 1;
+        }
+
+        for (uint64_t i = 0; i < count && packed_read(&reader, &packed); i++) {
+            struct Position pos;
+            int fullmove;
+            char fen[128];
+
+            unpack_position(&packed, &pos, &fullmove);
+            write_fen(&pos, fullmove, fen);
+
+            printf("%s; score %d; result %d\n", fen, packed.score, packed.result);
+        }
+
+        packed_reader_close(&reader);
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s datagen play <out.packed> <nodes=n | depth=d> [games] [threads]\n", argv[0]);
+    fprintf(stderr, "       %s datagen read <data.packed> [count]\n", argv[0]);
+    return 1;
+}
+
+int command_analyze(int argc, char** argv) {
+    struct Search_limits limits = {0};
+
+    if (argc < 5 || !parse_limit(argv[4], &limits)) {
+        fprintf(stderr, "usage: %s analyze <games.pgn> <annotated.pgn> <time=ms | nodes=n | depth=d> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    int num_threads = (argc > 5) ? atoi(argv[5]) : 0;
+    struct Analyze_stats stats;
+
+    load_engine_files();
+    int ret = analyze_pgn(argv[2], argv[3], &limits, num_threads, &stats);
+
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("%llu games, %llu positions, %llu skipped in %.2fs (%.2f games/s, %.0f nps)\n",
+        (unsigned long long)stats.games, (unsigned long long)stats.positions, (unsigned long long)stats.failed_games,
+        stats.seconds, stats.games / seconds, stats.nodes / seconds
+    );
+    printf("%llu blunders, %llu mistakes, %llu inaccuracies\n",
+        (unsigned long long)stats.blunders, (unsigned long long)stats.mistakes, (unsigned long long)stats.inaccuracies
+    );
+
+    return !ret;
+}
+
+int command_explorer(int argc, char** argv) {
+    if (argc >= 5 && !strcmp(argv[2], "build")) {
+        int max_ply = (argc > 5) ? atoi(argv[5]) : 30;
+        int num_threads = (argc > 6) ? atoi(argv[6]) : 0;
+        struct Explorer_stats stats;
+
+        int ret = build_explorer(argv[3], argv[4], max_ply, num_threads, &stats);
+
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        printf("%llu games, %llu positions, %llu moves in %.2fs (%.0f games/s)\n",
+            (unsigned long long)stats.games, (unsigned long long)stats.positions, (unsigned long long)stats.entries,
+            stats.seconds, stats.games / seconds
+        );
+
+        return !ret;
+    }
+
+    if (argc >= 4 && !strcmp(argv[2], "probe")) {
+        struct Position pos = starting_position;
+
+        if (argc > 4 && strcmp(argv[4], "startpos") && read_fen(argv[4], &pos, NULL) == 0) {
+            fprintf(stderr, "invalid fen %s\n", argv[4]);
+            return 1;
+        }
+
+        struct Explorer explorer;
+        if ( !explorer_open(&explorer, argv[3]) ) {
+            fprintf(stderr, "could not open %s\n", argv[3]);
+            return 1;
+        }
+
+        struct Explorer_move moves[MAX_MOVES];
+        struct Move legal_moves[MAX_MOVES];
+        int num_moves = explorer_probe(&explorer, &pos, moves);
+        int num_legal_moves = gen_move_list(&pos, legal_moves);
+
+        for (int i = 0; i < num_moves; i++) {
+            char move[16];
+            write_algebraic(&pos, legal_moves, num_legal_moves, moves[i].move, move);
+
+            printf("%-8s %8u  %5.1f%% / %5.1f%% / %5.1f%%\n", move, moves[i].games,
+                100.0 * moves[i].white_wins / moves[i].games, 100.0 * moves[i].draws / moves[i].games,
+                100.0 * moves[i].black_wins / moves[i].games
+            );
+        }
+
+        explorer_close(&explorer);
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s explorer build <games.db> <explorer.idx> [plies] [threads]\n", argv[0]);
+    fprintf(stderr, "       %s explorer probe <explorer.idx> [fen | startpos]\n", argv[0]);
+    return 1;
+}
+
+/*
+* Print at most max_games of postings, with names and result if db is open
+*/
+void _print_postings(struct Pos_index_posting* postings, uint64_t num_postings, uint64_t max_games, struct Db* db) {
+    const char *results[] = { "*", "*", "1-0", "0-1", "1/2-1/2" };
+
+    for (uint64_t i = 0; i < num_postings && i < max_games; i++) {
+        printf("game %llu, ply %u", (unsigned long long)postings[i].game, postings[i].ply);
+
+        if (db != NULL && postings[i].game < db->num_games) {
+            const char *white_name = db_game_tag(db, postings[i].game, "White");
+            const char *black_name = db_game_tag(db, postings[i].game, "Black");
+            int result = db->index[postings[i].game].result;
+
+            printf(": %s - %s %s", white_name ? white_name : "?", black_name ? black_name : "?",
+                results[result <= draw ? result : 0]
+            );
+        }
+
+        printf("\n");
+    }
+}
+
+int command_positions(int argc, char** argv) {
+    if (argc >= 5 && !strcmp(argv[2], "build")) {
+        int num_threads = (argc > 5) ? atoi(argv[5]) : 0;
+        struct Pos_index_stats stats;
+
+        int ret = build_pos_index(argv[3], argv[4], num_threads, &stats);
+
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        printf("%llu games, %llu positions, %llu material signatures, %llu postings from %llu runs, %.1f MB in %.2fs (%.0f games/s)\n",
+            (unsigned long long)stats.games, (unsigned long long)stats.positions, (unsigned long long)stats.materials,
+            (unsigned long long)stats.postings, (unsigned long long)stats.runs, stats.bytes / 1e6,
+            stats.seconds, stats.games / seconds
+        );
+
+        return !ret;
+    }
+
+    int material = argc >= 5 && !strcmp(argv[2], "material");
+
+    if (argc >= 5 && (material || !strcmp(argv[2], "find"))) {
+        struct Position pos = starting_position;
+        uint64_t signature = 0;
+
+        if (material && !parse_material_signature(argv[4], &signature)) {
+            fprintf(stderr, "invalid material %s\n", argv[4]);
+            return 1;
+        }
+
+        if (!material && strcmp(argv[4], "startpos") && read_fen(argv[4], &pos, NULL) == 0) {
+            fprintf(stderr, "invalid fen %s\n", argv[4]);
+            return 1;
+        }
+
+        struct Pos_index index;
+        if ( !pos_index_open(&index, argv[3]) ) {
+            fprintf(stderr, "could not open %s\n", argv[3]);
+            return 1;
+        }
+
+        struct Db db;
+        int have_db = argc > 5 && db_open(&db, argv[5]);
+        uint64_t max_games = (argc > 6) ? strtoull(argv[6], NULL, 10) : 20;
+
+        struct timespec start, stop;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        struct Pos_index_posting *postings = malloc(sizeof(struct Pos_index_posting) * (max_games ? max_games : 1));
+        uint64_t num_postings = material
+            ? pos_index_find_material(&index, signature, postings, max_games)
+            : pos_index_find(&index, &pos, postings, max_games);
+
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        double ms = (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6;
+
+        printf("%llu games in %.3f ms\n", (unsigned long long)num_postings, ms);
+        _print_postings(postings, num_postings, max_games, have_db ? &db : NULL);
+
+        free(postings);
+        if (have_db)
+            db_close(&db);
+        pos_index_close(&index);
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s positions build <games.db> <positions.idx> [threads]\n", argv[0]);
+    fprintf(stderr, "       %s positions find <positions.idx> <fen | startpos> [games.db] [count]\n", argv[0]);
+    fprintf(stderr, "       %s positions material <positions.idx> <KRPkr> [games.db] [count]\n", argv[0]);
+    return 1;
+}
+
+/*
+* Headless modes, selected by the first argument
+*/
+int run_command(int argc, char** argv) {
+    if ( !strcmp(argv[1], "import") )
+        return command_import(argc, argv);
+    if ( !strcmp(argv[1], "export") )
+        return command_export(argc, argv);
+    if ( !strcmp(argv[1], "epd") )
+        return command_epd(argc, argv);
+    if ( !strcmp(argv[1], "search") )
+        return command_search(argc, argv);
+    if ( !strcmp(argv[1], "bench") )
+        return command_bench(argc, argv);
+    if ( !strcmp(argv[1], "book") )
+        return command_book(argc, argv);
+    if ( !strcmp(argv[1], "tb") )
+        return command_tb(argc, argv);
+    if ( !strcmp(argv[1], "nnue") )
+        return command_nnue(argc, argv);
+    if ( !strcmp(argv[1], "tune") )
+        return command_tune(argc, argv);
+    if ( !strcmp(argv[1], "match") )
+        return command_match(argc, argv);
+    if ( !strcmp(argv[1], "datagen") )
+        return command_datagen(argc, argv);
+    if ( !strcmp(argv[1], "analyze") )
+        return command_analyze(argc, argv);
+    if ( !strcmp(argv[1], "explorer") )
+        return command_explorer(argc, argv);
+    if ( !strcmp(argv[1], "positions") )
+        return command_positions(argc, argv);
+
+    fprintf(stderr, "usage: %s [import | export | epd | search | bench | book | tb | nnue | tune | match | datagen | analyze | explorer | positions]\n", argv[0]);
+    return 1;
+}
+
+int main(int argc, char** argv) {
     init_log();
-    log_msg("(main) Starting session", 1);
+    log_msg("(main) Starting session", log_info);
+
+    if (argc > 1)
+        return run_command(argc, argv);
 
     init_tui();
     init_engine();
@@ -1,15 +1,6 @@
 #pragma once
 
+#include "log.h"
+
 #define VERSION_MAJ 1
 #define VERSION_MIN 1
-
-enum Verbosity {
-    verbose,
-    log,
-    error
-};
-
-void init_log();
-
-void log_msg(char* msg, enum Verbosity type);
-
@@ -0,0 +1,594 @@
+/**
+ * @file match.c
+ * @brief Engine against engine matches with a sequential probability ratio test
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Games are independent jobs of a thread pool, each with its own transposition tables.
+ * Finished games are counted, written and tested under a lock, in the order they finish.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "match.h"
+#include "backend.h"
+#include "engine.h"
+#include "book.h"
+#include "fen.h"
+#include "pgn.h"
+#include "tb.h"
+#include "nnue.h"
+#include "pool.h"
+#include "main.h"
+
+#define MATCH_BOOK_PLIES 16
+
+struct Match_opening {
+    struct Position start;
+    int fullmove;
+
+    // Played from start before the engines take over
+    struct Move moves[MATCH_BOOK_PLIES];
+    int num_moves;
+};
+
+struct Match {
+    const struct Match_engine *engines;
+    const struct Match_options *options;
+
+    struct Match_opening *openings;
+    int num_openings;
+
+    // Guards everything below
+    pthread_mutex_t lock;
+
+    FILE *pgn;
+    struct Match_stats *stats;
+    struct timespec start;
+
+    // Set once the SPRT is decided, games not yet started are skipped
+    int stop;
+};
+
+/*
+* Consecutive evaluations of a game, for adjudication
+*/
+struct Adjudication {
+    int draw_plies;
+    int win_plies;
+    int win_sign;
+};
+
+/*** Constants ***/
+
+const struct Match_options default_match_options = {
+    .depth = 0, .nodes = 0, .move_time_ms = 0,
+    .base_ms = 0, .increment_ms = 0,
+    .games = 100, .num_threads = 0,
+    .openings_path = NULL, .pgn_path = NULL,
+    .elo0 = 0, .elo1 = 5, .alpha = 0.05, .beta = 0.05
+};
+
+const int match_tt_size_mb = 8;
+
+// Plies taken from a book, if it has that many
+const int match_book_plies = 8;
+
+// Share of the remaining clock spent on a move, besides most of the increment
+const int match_moves_to_go = 30;
+
+// Draw once both engines see at most draw_score for draw_plies plies, from draw_after_ply on
+const int match_draw_after_ply = 80;
+const int match_draw_score = 100;
+const int match_draw_plies = 8;
+
+// Win once both engines agree on at least resign_score for resign_plies plies
+const int match_resign_score = 6000;
+const int match_resign_plies = 6;
+
+// Games reaching this length are drawn
+const int match_max_plies = 600;
+
+/*** Math ***/
+
+/*
+* Expected score against an opponent elo weaker
+*/
+double _elo_to_score(double elo) {
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+double _score_to_elo(double score) {
+    if (score <= 0)
+        return -1000;
+    if (score >= 1)
+        return 1000;
+
+    return -400 * log10(1 / score - 1);
+}
+
+/*
+* Elo estimate, confidence interval and log-likelihood ratio of the SPRT, from the game
+* results with the normal approximation of the generalized SPRT
+*/
+void _update_estimates(struct Match_stats* stats, const struct Match_options* options) {
+    double n = stats->games;
+
+    stats->lower_bound = log(options->beta / (1 - options->alpha));
+    stats->upper_bound = log((1 - options->beta) / options->alpha);
+
+    if (n == 0)
+        return;
+
+    double score = (stats->wins + stats->draws / 2.0) / n;
+
+    // A pseudo-count of each result keeps the variance positive after one-sided results
+    double w = (stats->wins + 0.5) / (n + 1.5), d = (stats->draws + 0.5) / (n + 1.5), l = (stats->losses + 0.5) / (n + 1.5);
+    double variance = w * (1 - score) * (1 - score) + d * (0.5 - score) * (0.5 - score) + l * score * score;
+
+    double error = sqrt(variance / n);
+
+    stats->elo = _score_to_elo(score);
+    stats->elo_error = (_score_to_elo(score + 1.96 * error) - _score_to_elo(score - 1.96 * error)) / 2;
+
+    double s0 = _elo_to_score(options->elo0);
+    double s1 = _elo_to_score(options->elo1);
+
+    stats->llr = n * (s1 - s0) * (2 * score - s0 - s1) / (2 * variance);
+
+    if (stats->llr >= stats->upper_bound)
+        stats->sprt_result = 1;
+    else if (stats->llr <= stats->lower_bound)
+        stats->sprt_result = -1;
+}
+
+/*** Openings ***/
+
+void _add_opening(struct Match* match, const struct Match_opening* opening, int* capacity) {
+    if (match->num_openings == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 64;
+        match->openings = realloc(match->openings, sizeof(struct Match_opening) * *capacity);
+    }
+
+    match->openings[match->num_openings++] = *opening;
+}
+
+/*
+* Random walks through the book, one per game pair
+*/
+int _book_openings(struct Match* match, const char* path) {
+    struct Book book;
+    if ( !book_open(&book, path) )
+        return 0;
+
+    int capacity = 0;
+    uint64_t seed = time(NULL);
+
+    for (int i = 0; i < (match->options->games + 1) / 2; i++) {
+        struct Match_opening opening = { .start = starting_position, .fullmove = 1 };
+        struct Position positions[2] = { starting_position };
+
+        while (opening.num_moves < match_book_plies && opening.num_moves < MATCH_BOOK_PLIES) {
+            struct Position *pos = &positions[opening.num_moves % 2];
+            struct Move move;
+
+            if ( !book_choose_move(&book, pos, &seed, &move) )
+                break;
+
+            opening.moves[opening.num_moves++] = move;
+            unsafe_play_move_to(pos, &positions[opening.num_moves % 2], move.from, move.to, move.promote);
+        }
+
+        _add_opening(match, &opening, &capacity);
+    }
+
+    book_close(&book);
+    return 1;
+}
+
+/*
+* Positions of a FEN/EPD file, in random order
+*/
+int _file_openings(struct Match* match, const char* path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return 0;
+
+    char line[1024];
+    int capacity = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        struct Match_opening opening = { 0 };
+
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        if (read_fen(line, &opening.start, &opening.fullmove) == 0) {
+            log_printf(error, "Error in _file_openings(): skipping malformed line %s", line);
+            continue;
+        }
+
+        if (opening.fullmove < 1)
+            opening.fullmove = 1;
+
+        _add_opening(match, &opening, &capacity);
+    }
+
+    fclose(file);
+
+    // Fisher-Yates with xorshift
+    uint64_t seed = (uint64_t)time(NULL) * 0x9e3779b97f4a7c15ull | 1;
+
+    for (int i = match->num_openings - 1; i > 0; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        int j = seed % (i + 1);
+        struct Match_opening opening = match->openings[i];
+        match->openings[i] = match->openings[j];
+        match->openings[j] = opening;
+    }
+
+    return 1;
+}
+
+int _load_openings(struct Match* match) {
+    const char *path = match->options->openings_path;
+    size_t length = path ? strlen(path) : 0;
+
+    if (path == NULL) {
+        struct Match_opening opening = { .start = starting_position, .fullmove = 1 };
+        int capacity = 0;
+
+        _add_opening(match, &opening, &capacity);
+        return 1;
+    }
+
+    int ret = (length > 4 && !strcmp(path + length - 4, ".bin")) ? _book_openings(match, path) : _file_openings(match, path);
+
+    if (!ret || match->num_openings == 0) {
+        log_msg("Error in run_match(): could not read any openings", error);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*** Adjudication ***/
+
+/*
+* Neither side has more than a single knight or bishop
+*/
+int _insufficient_material(const struct Position* pos) {
+    int minors = 0;
+
+    for (int square = 0; square < 64; square++) {
+        switch (pos->board[square]) {
+            case o: case K: case k:
+                break;
+            case N: case B: case n: case b:
+                minors++;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    return minors <= 1;
+}
+
+/*
+* Decide the game in pos, eval being the evaluation of the engine that just moved from
+* whites point of view
+* returns: white_win, black_win or draw, white (= none) if the game goes on
+*/
+enum Game_state _adjudicate(struct Adjudication* adjudication, struct Position* pos, int ply, int eval) {
+    int wdl, dtm;
+
+    if ( tb_probe(pos, &wdl, &dtm) ) {
+        if (wdl == 0)
+            return draw;
+        return (wdl > 0) == (pos->state == white) ? white_win : black_win;
+    }
+
+    if ( _insufficient_material(pos) )
+        return draw;
+
+    if (ply >= match_draw_after_ply && abs(eval) <= match_draw_score)
+        adjudication->draw_plies++;
+    else
+        adjudication->draw_plies = 0;
+
+    if (adjudication->draw_plies >= match_draw_plies)
+        return draw;
+
+    int sign = (eval >= match_resign_score) - (eval <= -match_resign_score);
+
+    if (sign != 0 && sign == adjudication->win_sign)
+        adjudication->win_plies++;
+    else
+        adjudication->win_plies = (sign != 0);
+
+    adjudication->win_sign = sign;
+
+    if (adjudication->win_plies >= match_resign_plies)
+        return sign > 0 ? white_win : black_win;
+
+    return white;
+}
+
+/*** Playing ***/
+
+/*
+* Time to spend on a move with clock milliseconds left
+*/
+int _allot_time(int clock, int increment) {
+    int time_ms = clock / match_moves_to_go + increment * 3 / 4;
+
+    if (time_ms > clock / 2)
+        time_ms = clock / 2;
+
+    // 0 would be unlimited
+    return time_ms > 0 ? time_ms : 1;
+}
+
+void _format_time_control(const struct Match_options* options, char* s, size_t size) {
+    if (options->base_ms)
+        snprintf(s, size, "%g+%g", options->base_ms / 1000.0, options->increment_ms / 1000.0);
+    else if (options->move_time_ms)
+        snprintf(s, size, "%g/move", options->move_time_ms / 1000.0);
+    else
+        snprintf(s, size, "-");
+}
+
+void _set_tag(struct Pgn_tag* tag, const char* name, const char* value) {
+    tag->name = (struct Pgn_token) { name, strlen(name) };
+    tag->value = (struct Pgn_token) { value, strlen(value) };
+}
+
+void _write_game(struct Match* match, int index, struct Game* game, const struct Match_opening* opening, const char* termination, struct Pgn_writer* writer) {
+    const char *results[] = { "*", "*", "1-0", "0-1", "1/2-1/2" };
+    int swap = index % 2;
+
+    char round[16], fen[128], time_control[32];
+    snprintf(round, sizeof(round), "%d", index + 1);
+    _format_time_control(match->options, time_control, sizeof(time_control));
+
+    struct Pgn_tag tags[9];
+    int num_tags = 0;
+
+    _set_tag(&tags[num_tags++], "Event", "Engine match");
+    _set_tag(&tags[num_tags++], "Round", round);
+    _set_tag(&tags[num_tags++], "White", match->engines[swap].name);
+    _set_tag(&tags[num_tags++], "Black", match->engines[!swap].name);
+    _set_tag(&tags[num_tags++], "Result", results[ game->positions[game->halfmove].state ]);
+    _set_tag(&tags[num_tags++], "TimeControl", time_control);
+
+    if (termination != NULL)
+        _set_tag(&tags[num_tags++], "Termination", termination);
+
+    if ( memcmp(&opening->start, &starting_position, sizeof(struct Position)) ) {
+        write_fen(&opening->start, opening->fullmove, fen);
+        _set_tag(&tags[num_tags++], "SetUp", "1");
+        _set_tag(&tags[num_tags++], "FEN", fen);
+    }
+
+    writer->fullmove = opening->fullmove;
+    pgn_write_game(writer, tags, num_tags, game);
+}
+
+/*
+* Count the result, write the game and check the SPRT
+*/
+void _finish_game(struct Match* match, int index, enum Game_state result, const char* termination, struct Pgn_writer* writer) {
+    struct Match_stats *stats = match->stats;
+    int swap = index % 2;
+
+    pthread_mutex_lock(&match->lock);
+
+    stats->games++;
+    if (result == draw)
+        stats->draws++;
+    else if ((result == white_win) != swap)
+        stats->wins++;
+    else
+        stats->losses++;
+
+    if (termination != NULL && !strcmp(termination, "adjudication"))
+        stats->adjudicated++;
+    if (termination != NULL && !strcmp(termination, "time forfeit"))
+        stats->time_losses++;
+
+    if (match->pgn != NULL) {
+        fwrite(writer->buffer, 1, writer->size, match->pgn);
+        fflush(match->pgn);
+    }
+
+    _update_estimates(stats, match->options);
+
+    const char *results[] = { "*", "*", "1-0", "0-1", "1/2-1/2" };
+
+    printf("Game %4d %s - %s %-7s | +%d =%d -%d | Elo %6.1f +- %5.1f | LLR %5.2f [%.2f, %.2f]\n",
+        index + 1, match->engines[swap].name, match->engines[!swap].name, results[result],
+        stats->wins, stats->draws, stats->losses, stats->elo, stats->elo_error,
+        stats->llr, stats->lower_bound, stats->upper_bound
+    );
+    fflush(stdout);
+
+    if (stats->sprt_result != 0)
+        match->stop = 1;
+
+    pthread_mutex_unlock(&match->lock);
+}
+
+/*
+* Play game index, engines[index % 2] having white
+*/
+void _play_game(int index, void* data) {
+    struct Match *match = data;
+    const struct Match_options *options = match->options;
+    const struct Match_opening *opening = &match->openings[(index / 2) % match->num_openings];
+
+    pthread_mutex_lock(&match->lock);
+    int stop = match->stop;
+    pthread_mutex_unlock(&match->lock);
+
+    if (stop)
+        return;
+
+    int swap = index % 2;
+
+    struct Transposition_table tts[2];
+    init_tt(&tts[0], match_tt_size_mb);
+    init_tt(&tts[1], match_tt_size_mb);
+
+    struct Game game;
+    init_game(&game, &opening->start, 2 * MATCH_BOOK_PLIES);
+
+    for (int i = 0; i < opening->num_moves; i++) {
+        unsafe_play_move(&game, opening->moves[i].from, opening->moves[i].to, opening->moves[i].promote);
+        update_game_state(&game);
+    }
+
+    int clocks[2] = { options->base_ms, options->base_ms };
+    struct Adjudication adjudication = { 0 };
+    const char *termination = NULL;
+    uint64_t history[UINT8_MAX];
+
+    while (game.positions[game.halfmove].state == white || game.positions[game.halfmove].state == black) {
+        struct Position *pos = &game.positions[game.halfmove];
+        int engine = (pos->state == black) ^ swap;
+
+        struct Search_limits limits = { .depth = options->depth, .nodes = options->nodes, .time_ms = options->move_time_ms };
+        limits.history = history;
+        limits.history_length = game_keys(&game, history, UINT8_MAX);
+        limits.params = &match->engines[engine].params;
+        limits.static_eval_only = !match->engines[engine].use_nnue;
+
+        if (options->base_ms)
+            limits.time_ms = _allot_time(clocks[engine], options->increment_ms);
+
+        struct Search_result result;
+        search(pos, &limits, &tts[engine], &result);
+
+        if (options->base_ms) {
+            clocks[engine] -= (int)(result.seconds * 1000);
+
+            if (clocks[engine] < 0) {
+                pos->state = pos->state == white ? black_win : white_win;
+                termination = "time forfeit";
+                break;
+            }
+
+            clocks[engine] += options->increment_ms;
+        }
+
+        if (game.halfmove + 1 >= game.max_moves)
+            resize_game(&game, 2 * game.max_moves);
+
+        unsafe_play_move(&game, result.best_move.from, result.best_move.to, result.best_move.promote);
+        update_game_state(&game);
+
+        pos = &game.positions[game.halfmove];
+        if (pos->state != white && pos->state != black)
+            break;
+
+        enum Game_state adjudicated = _adjudicate(&adjudication, pos, game.halfmove, result.eval);
+
+        if (adjudicated == white && game.halfmove >= match_max_plies)
+            adjudicated = draw;
+
+        if (adjudicated != white) {
+            pos->state = adjudicated;
+            termination = "adjudication";
+        }
+    }
+
+    delete_tt(&tts[0]);
+    delete_tt(&tts[1]);
+
+    struct Pgn_writer writer;
+    pgn_writer_open(&writer, NULL);
+
+    _write_game(match, index, &game, opening, termination, &writer);
+    _finish_game(match, index, game.positions[game.halfmove].state, termination, &writer);
+
+    pgn_writer_close(&writer);
+    delete_game(&game);
+}
+
+/*** Functions ***/
+
+int load_match_engine(const char* spec, struct Match_engine* engine) {
+    memset(engine, 0, sizeof(struct Match_engine));
+    engine->params = eval_params;
+
+    // File name without directory and extension
+    const char *name = strrchr(spec, '/') ? strrchr(spec, '/') + 1 : spec;
+    snprintf(engine->name, sizeof(engine->name), "%.*s", (int)strcspn(name, "."), name);
+
+    if ( !strcmp(spec, "default") )
+        return 1;
+
+    if ( !strcmp(spec, "nnue") ) {
+        if ( !nnue_loaded() ) {
+            log_msg("Error in load_match_engine(): no network loaded", error);
+            return 0;
+        }
+
+        engine->use_nnue = 1;
+        return 1;
+    }
+
+    return load_eval_params(spec, &engine->params);
+}
+
+int run_match(const struct Match_engine engines[2], const struct Match_options* options, struct Match_stats* stats) {
+    memset(stats, 0, sizeof(struct Match_stats));
+
+    struct Match match = { .engines = engines, .options = options, .stats = stats };
+    pthread_mutex_init(&match.lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &match.start);
+
+    _update_estimates(stats, options);
+
+    if ( !_load_openings(&match) ) {
+        pthread_mutex_destroy(&match.lock);
+        return 0;
+    }
+
+    if (options->pgn_path != NULL) {
+        match.pgn = fopen(options->pgn_path, "a");
+
+        if (match.pgn == NULL) {
+            log_msg("Error in run_match(): could not open PGN file", error);
+            free(match.openings);
+            pthread_mutex_destroy(&match.lock);
+            return 0;
+        }
+    }
+
+    parallel_for(options->games, options->num_threads, _play_game, &match);
+
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - match.start.tv_sec) + (stop.tv_nsec - match.start.tv_nsec) / 1e9;
+
+    int ret = 1;
+    if (match.pgn != NULL)
+        ret = fclose(match.pgn) == 0;
+
+    free(match.openings);
+    pthread_mutex_destroy(&match.lock);
+
+    return ret;
+}
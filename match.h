@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/*
+* One side of a match, a configuration of the engine
+*/
+struct Match_engine {
+    char name[64];
+    struct Eval_params params;
+
+    // Evaluate with the loaded network instead of params
+    int use_nnue;
+};
+
+struct Match_options {
+    // Limits of every move, as for search()
+    int depth;
+    uint64_t nodes;
+    int move_time_ms;
+
+    // Clock of each side, 0 for none: time for the game and increment per move
+    int base_ms;
+    int increment_ms;
+
+    // Games are played in pairs from the same opening, with colors swapped
+    int games;
+    int num_threads;
+
+    // Polyglot book (".bin") or file of FEN/EPD lines to start the games from, NULL
+    // for the starting position
+    const char *openings_path;
+
+    // Games are appended as they finish, may be NULL
+    const char *pgn_path;
+
+    // SPRT of H0: the first engine is elo0 stronger than the second, against H1: elo1
+    // stronger, with error probabilities alpha and beta
+    double elo0, elo1;
+    double alpha, beta;
+};
+
+/*
+* Results from the point of view of the first engine
+*/
+struct Match_stats {
+    int games;
+    int wins;
+    int draws;
+    int losses;
+
+    // Decided by adjudication or on time, included above
+    int adjudicated;
+    int time_losses;
+
+    // Elo difference with its 95% confidence interval, elo +- elo_error
+    double elo;
+    double elo_error;
+
+    // Log-likelihood ratio of the SPRT, stopped once outside [lower_bound, upper_bound]
+    double llr;
+    double lower_bound;
+    double upper_bound;
+
+    // 1 if H1 was accepted, -1 if H0 was, 0 if the test is still running
+    int sprt_result;
+
+    double seconds;
+};
+
+extern const struct Match_options default_match_options;
+
+/*
+* Read an engine configuration: "default" for eval_params, "nnue" for the loaded network,
+* or the path of a parameter file (see load_eval_params()) changing eval_params
+* returns: success of operation
+*/
+int load_match_engine(const char* spec, struct Match_engine* engine);
+
+/*
+* Play engines[0] against engines[1], options->num_threads games at a time (0 = one per
+* core). Games end by the rules, on time or by adjudication:
+*   - a position found in the endgame tablebases, or without enough material to mate
+*   - both engines agreeing on a decisive evaluation for several moves
+*   - both engines seeing a dead draw for several moves, late enough in the game
+*
+* A line is printed for every finished game with the running score, Elo estimate and
+* SPRT state. Stops early when the SPRT accepts either hypothesis
+* returns: success of operation
+*/
+int run_match(const struct Match_engine engines[2], const struct Match_options* options, struct Match_stats* stats);
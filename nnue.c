@@ -0,0 +1,438 @@
+/**
+ * @file nnue.c
+ * @brief Neural network evaluation with an incrementally updated first layer, see nnue.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Positions are copied instead of made and unmade, so an update compares the boards of
+ * parent and child: a move changes at most four squares. The AVX2 kernels are compiled
+ * with target attributes and used when the CPU supports them, like the ones of simd.c.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#else
+#define HAVE_AVX2_KERNELS 0
+#endif
+
+#include "nnue.h"
+#include "main.h"
+
+// Changed squares of a single move, castling being the most
+#define MAX_CHANGES 4
+
+struct Nnue_network {
+    int16_t *feature_bias;
+    int16_t *feature_weights;
+    int8_t *output_weights;
+    int32_t output_bias;
+    int32_t scale;
+};
+
+/*** Constants ***/
+
+const char nnue_magic[8] = "CHESSNN";
+const uint32_t nnue_version = 1;
+
+// Kind of every piece as a feature, -1 for none
+const int nnue_kinds[15] = {
+    -1,
+    0, 0, 1, 2, 3, 4, -1,
+    0, 0, 1, 2, 3, 4, -1
+};
+
+// Pieces without their en passant state
+const enum Piece nnue_plain[15] = {
+    o,
+    P, P, N, B, R, Q, K,
+    p, p, n, b, r, q, k
+};
+
+// Of the material network, in pawns
+const int nnue_material[5] = { 1, 3, 3, 5, 9 };
+
+/*** State ***/
+
+struct Nnue_network nnue_network;
+int nnue_is_loaded;
+int nnue_avx2;
+
+/*** Kernels ***/
+
+/*
+* out = in + the rows of added - the rows of removed
+*/
+void _update_rows_scalar(int16_t* out, const int16_t* in, const int* added, int num_added, const int* removed, int num_removed) {
+    memcpy(out, in, sizeof(int16_t) * NNUE_HIDDEN);
+
+    for (int i = 0; i < num_added; i++) {
+        const int16_t *row = nnue_network.feature_weights + (size_t)added[i] * NNUE_HIDDEN;
+
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            out[j] += row[j];
+    }
+
+    for (int i = 0; i < num_removed; i++) {
+        const int16_t *row = nnue_network.feature_weights + (size_t)removed[i] * NNUE_HIDDEN;
+
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            out[j] -= row[j];
+    }
+}
+
+int _output_scalar(const int16_t* values, const int8_t* weights) {
+    int sum = 0;
+
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        int value = values[i] < 0 ? 0 : (values[i] > 127 ? 127 : values[i]);
+        sum += value * weights[i];
+    }
+
+    return sum;
+}
+
+#if HAVE_AVX2_KERNELS
+
+__attribute__((target("avx2")))
+void _update_rows_avx2(int16_t* out, const int16_t* in, const int* added, int num_added, const int* removed, int num_removed) {
+    // 64 values at a time stay in registers over all rows
+    for (int j = 0; j < NNUE_HIDDEN; j += 64) {
+        __m256i sums[4];
+
+        for (int k = 0; k < 4; k++)
+            sums[k] = _mm256_loadu_si256((const __m256i*)(in + j + 16*k));
+
+        for (int i = 0; i < num_added; i++) {
+            const int16_t *row = nnue_network.feature_weights + (size_t)added[i] * NNUE_HIDDEN + j;
+
+            for (int k = 0; k < 4; k++)
+                sums[k] = _mm256_add_epi16(sums[k], _mm256_loadu_si256((const __m256i*)(row + 16*k)));
+        }
+
+        for (int i = 0; i < num_removed; i++) {
+            const int16_t *row = nnue_network.feature_weights + (size_t)removed[i] * NNUE_HIDDEN + j;
+
+            for (int k = 0; k < 4; k++)
+                sums[k] = _mm256_sub_epi16(sums[k], _mm256_loadu_si256((const __m256i*)(row + 16*k)));
+        }
+
+        for (int k = 0; k < 4; k++)
+            _mm256_storeu_si256((__m256i*)(out + j + 16*k), sums[k]);
+    }
+}
+
+__attribute__((target("avx2")))
+int _output_avx2(const int16_t* values, const int8_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(127);
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+        __m256i low = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(values + i)), zero), max);
+        __m256i high = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(values + i + 16)), zero), max);
+
+        // Packing works within 128 bit lanes, the permutation restores the order
+        __m256i clamped = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        __m256i products = _mm256_maddubs_epi16(clamped, _mm256_loadu_si256((const __m256i*)(weights + i)));
+
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+
+    return _mm_cvtsi128_si32(half);
+}
+
+#endif
+
+void _update_rows(int16_t* out, const int16_t* in, const int* added, int num_added, const int* removed, int num_removed) {
+#if HAVE_AVX2_KERNELS
+    if (nnue_avx2) {
+        _update_rows_avx2(out, in, added, num_added, removed, num_removed);
+        return;
+    }
+#endif
+    _update_rows_scalar(out, in, added, num_added, removed, num_removed);
+}
+
+int _output(const int16_t* values, const int8_t* weights) {
+#if HAVE_AVX2_KERNELS
+    if (nnue_avx2)
+        return _output_avx2(values, weights);
+#endif
+    return _output_scalar(values, weights);
+}
+
+/*** Features ***/
+
+int _feature(int side, int king_square, enum Piece piece, int square) {
+    // Black sees the board upside down
+    int orient = (side == white) ? 0 : 56;
+    int theirs = is_black(piece) != (side == black);
+
+    return ((king_square ^ orient) * 10 + theirs * 5 + nnue_kinds[piece]) * 64 + (square ^ orient);
+}
+
+void _refresh_side(const struct Position* pos, int side, struct Nnue_accumulator* acc) {
+    int features[32];
+    int num_features = 0;
+
+    for (int square = 0; square < 64; square++) {
+        enum Piece piece = pos->board[square];
+
+        if (nnue_kinds[piece] >= 0 && num_features < 32)
+            features[num_features++] = _feature(side, acc->king_squares[side], piece, square);
+    }
+
+    _update_rows(acc->values[side], nnue_network.feature_bias, features, num_features, NULL, 0);
+}
+
+/*** Functions ***/
+
+int nnue_load(const char* path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        log_printf(error, "Error in nnue_load(): could not open %s", path);
+        return 0;
+    }
+
+    struct Nnue_header header;
+    struct Nnue_network network = {0};
+
+    size_t num_weights = (size_t)NNUE_FEATURES * NNUE_HIDDEN;
+
+    network.feature_bias = aligned_alloc(32, sizeof(int16_t) * NNUE_HIDDEN);
+    network.feature_weights = aligned_alloc(32, sizeof(int16_t) * num_weights);
+    network.output_weights = aligned_alloc(32, 2 * NNUE_HIDDEN);
+
+    int ret =
+        fread(&header, sizeof(header), 1, file) == 1 &&
+        !memcmp(header.magic, nnue_magic, sizeof(nnue_magic)) && header.version == nnue_version &&
+        header.num_features == NNUE_FEATURES && header.hidden == NNUE_HIDDEN &&
+        fread(network.feature_bias, sizeof(int16_t), NNUE_HIDDEN, file) == NNUE_HIDDEN &&
+        fread(network.feature_weights, sizeof(int16_t), num_weights, file) == num_weights &&
+        fread(network.output_weights, 1, 2 * NNUE_HIDDEN, file) == 2 * NNUE_HIDDEN &&
+        fread(&network.output_bias, sizeof(int32_t), 1, file) == 1;
+
+    fclose(file);
+
+    if (!ret) {
+        log_printf(error, "Error in nnue_load(): %s is not a network of this architecture", path);
+        free(network.feature_bias);
+        free(network.feature_weights);
+        free(network.output_weights);
+        return 0;
+    }
+
+    network.scale = header.scale;
+
+    if (nnue_is_loaded) {
+        free(nnue_network.feature_bias);
+        free(nnue_network.feature_weights);
+        free(nnue_network.output_weights);
+    }
+
+    nnue_network = network;
+    nnue_is_loaded = 1;
+
+#if HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    nnue_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    log_printf(log_info, "(nnue) Loaded %s, %s kernels", path, nnue_avx2 ? "avx2" : "scalar");
+    return 1;
+}
+
+int nnue_loaded() {
+    return nnue_is_loaded;
+}
+
+int nnue_write_material_net(const char* path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        log_printf(error, "Error in nnue_write_material_net(): could not open %s", path);
+        return 0;
+    }
+
+    // Neuron 0 counts our material, neuron 1 theirs. Both sides count, so halve the scale
+    struct Nnue_header header = { {0}, nnue_version, NNUE_FEATURES, NNUE_HIDDEN, 1024 * 1000 / 2 };
+    memcpy(header.magic, nnue_magic, sizeof(nnue_magic));
+
+    int16_t row[NNUE_HIDDEN] = {0};
+    int8_t output_weights[2 * NNUE_HIDDEN] = { 1, -1 };
+    int32_t output_bias = 0;
+
+    output_weights[NNUE_HIDDEN] = -1;
+    output_weights[NNUE_HIDDEN + 1] = 1;
+
+    int ret =
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(row, sizeof(row), 1, file) == 1;
+
+    for (int feature = 0; feature < NNUE_FEATURES && ret; feature++) {
+        int kind = (feature / 64) % 5;
+        int theirs = (feature / 64) % 10 >= 5;
+
+        row[0] = theirs ? 0 : nnue_material[kind];
+        row[1] = theirs ? nnue_material[kind] : 0;
+
+        ret = fwrite(row, sizeof(row), 1, file) == 1;
+    }
+
+    ret = ret &&
+        fwrite(output_weights, sizeof(output_weights), 1, file) == 1 &&
+        fwrite(&output_bias, sizeof(output_bias), 1, file) == 1;
+
+    ret = (fclose(file) == 0) && ret;
+
+    if (!ret)
+        log_printf(error, "Error in nnue_write_material_net(): could not write %s", path);
+
+    return ret;
+}
+
+void nnue_refresh(const struct Position* pos, struct Nnue_accumulator* acc) {
+    for (int square = 0; square < 64; square++) {
+        if (pos->board[square] == K)
+            acc->king_squares[white] = square;
+        else if (pos->board[square] == k)
+            acc->king_squares[black] = square;
+    }
+
+    _refresh_side(pos, white, acc);
+    _refresh_side(pos, black, acc);
+}
+
+void nnue_update(const struct Nnue_accumulator* parent, const struct Position* parent_pos, const struct Position* pos, struct Nnue_accumulator* acc) {
+    int changes[MAX_CHANGES];
+    int num_changes = 0;
+
+    acc->king_squares[white] = parent->king_squares[white];
+    acc->king_squares[black] = parent->king_squares[black];
+
+    for (int square = 0; square < 64; square++) {
+        enum Piece piece = nnue_plain[ pos->board[square] ];
+
+        if (piece == nnue_plain[ parent_pos->board[square] ])
+            continue;
+
+        // Not a single move, start over
+        if (num_changes == MAX_CHANGES) {
+            nnue_refresh(pos, acc);
+            return;
+        }
+
+        changes[num_changes++] = square;
+
+        if (piece == K)
+            acc->king_squares[white] = square;
+        else if (piece == k)
+            acc->king_squares[black] = square;
+    }
+
+    for (int side = white; side <= black; side++) {
+        // Every feature depends on the square of the king
+        if (acc->king_squares[side] != parent->king_squares[side]) {
+            _refresh_side(pos, side, acc);
+            continue;
+        }
+
+        int added[MAX_CHANGES], removed[MAX_CHANGES];
+        int num_added = 0, num_removed = 0;
+
+        for (int i = 0; i < num_changes; i++) {
+            enum Piece old = parent_pos->board[changes[i]];
+            enum Piece new = pos->board[changes[i]];
+
+            if (nnue_kinds[old] >= 0)
+                removed[num_removed++] = _feature(side, acc->king_squares[side], old, changes[i]);
+            if (nnue_kinds[new] >= 0)
+                added[num_added++] = _feature(side, acc->king_squares[side], new, changes[i]);
+        }
+
+        _update_rows(acc->values[side], parent->values[side], added, num_added, removed, num_removed);
+    }
+}
+
+int nnue_evaluate(const struct Nnue_accumulator* acc, enum Game_state side) {
+    int other = (side == white) ? black : white;
+
+    int64_t sum = nnue_network.output_bias
+        + _output(acc->values[side], nnue_network.output_weights)
+        + _output(acc->values[other], nnue_network.output_weights + NNUE_HIDDEN);
+
+    return sum * nnue_network.scale / 1024;
+}
+
+int nnue_eval(const struct Position* pos) {
+    struct Nnue_accumulator acc;
+    nnue_refresh(pos, &acc);
+
+    return nnue_evaluate(&acc, white);
+}
+
+/*** Checking ***/
+
+uint64_t _nnue_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+uint64_t nnue_check(int num_playouts, int max_plies, uint64_t seed, uint64_t* num_positions) {
+    uint64_t mismatches = 0;
+    *num_positions = 0;
+
+    for (int playout = 0; playout < num_playouts; playout++) {
+        struct Position positions[2];
+        struct Nnue_accumulator accs[2], refreshed;
+
+        positions[0] = starting_position;
+        nnue_refresh(&positions[0], &accs[0]);
+
+        for (int ply = 0; ply < max_plies; ply++) {
+            struct Position *crnt_pos = &positions[ply % 2], *new_pos = &positions[(ply+1) % 2];
+            struct Move moves[MAX_MOVES];
+            int num_moves = gen_move_list(crnt_pos, moves);
+
+            if (num_moves == 0)
+                break;
+
+            struct Move move = moves[ _nnue_random(&seed) % num_moves ];
+            unsafe_play_move_to(crnt_pos, new_pos, move.from, move.to, move.promote);
+
+            nnue_update(&accs[ply % 2], crnt_pos, new_pos, &accs[(ply+1) % 2]);
+            nnue_refresh(new_pos, &refreshed);
+            (*num_positions)++;
+
+            const struct Nnue_accumulator *updated = &accs[(ply+1) % 2];
+
+            if (
+                memcmp(updated->values, refreshed.values, sizeof(refreshed.values)) ||
+                memcmp(updated->king_squares, refreshed.king_squares, sizeof(refreshed.king_squares))
+            ) {
+                log_printf(error, "Error in nnue_check(): update differs from refresh in playout %d at ply %d", playout, ply + 1);
+                mismatches++;
+
+                // Go on from the correct values
+                accs[(ply+1) % 2] = refreshed;
+            }
+        }
+    }
+
+    return mismatches;
+}
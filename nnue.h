@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Efficiently updatable neural network evaluation.
+*
+* Features are HalfKP: for each side, every piece other than the kings on every square,
+* relative to the square of that sides king. Boards are mirrored vertically for black,
+* so both sides see themselves moving up the board:
+*
+*   feature = (king * 10 + theirs * 5 + kind) * 64 + square
+*
+* with kind 0 = pawn ... 4 = queen. The first layer sums the weights of all active
+* features into an accumulator of NNUE_HIDDEN int16 values per side. It is updated
+* incrementally from the one of the previous position and rebuilt only after a king move.
+* The output is
+*
+*   (bias + sum of clamp(us, 0, 127) * weight + sum of clamp(them, 0, 127) * weight) * scale / 1024
+*
+* with int8 weights, in 1/1000 pawn from the side to moves point of view.
+*
+* Network files, version 1, little-endian:
+*
+*   struct Nnue_header
+*   int16_t  feature_bias[NNUE_HIDDEN]
+*   int16_t  feature_weights[NNUE_FEATURES][NNUE_HIDDEN]
+*   int8_t   output_weights[2 * NNUE_HIDDEN]        side to move first
+*   int32_t  output_bias
+*/
+#define NNUE_HIDDEN 256
+#define NNUE_FEATURES (64 * 10 * 64)
+
+struct Nnue_header {
+    char magic[8];
+    uint32_t version;
+
+    uint32_t num_features;
+    uint32_t hidden;
+    int32_t scale;
+};
+
+struct Nnue_accumulator {
+    int16_t values[2][NNUE_HIDDEN] __attribute__((aligned(32)));
+
+    // Squares of the white and black king the values belong to
+    uint8_t king_squares[2];
+};
+
+/*
+* Load the network at path, replacing the one loaded before. Not thread safe
+* returns: success of operation
+*/
+int nnue_load(const char* path);
+
+/*
+* returns: if a network is loaded
+*/
+int nnue_loaded();
+
+/*
+* Write a network that only counts material (pawn 1, knight and bishop 3, rook 5,
+* queen 9), for testing
+* returns: success of operation
+*/
+int nnue_write_material_net(const char* path);
+
+/*
+* Compute the accumulator of pos from scratch
+*/
+void nnue_refresh(const struct Position* pos, struct Nnue_accumulator* acc);
+
+/*
+* Compute the accumulator of pos from the one of parent_pos, pos being reachable with a
+* single move
+*/
+void nnue_update(const struct Nnue_accumulator* parent, const struct Position* parent_pos, const struct Position* pos, struct Nnue_accumulator* acc);
+
+/*
+* returns: evaluation from the point of view of side
+*/
+int nnue_evaluate(const struct Nnue_accumulator* acc, enum Game_state side);
+
+/*
+* Evaluate pos from scratch
+* returns: evaluation from whites point of view, like static_eval()
+*/
+int nnue_eval(const struct Position* pos);
+
+/*
+* Play num_playouts games of up to max_plies random moves from starting_position, seeded
+* with seed, and compare the accumulator of every position computed by nnue_update() to
+* the one of nnue_refresh(). Needs a loaded network
+* returns: number of positions whose accumulators differ, num_positions the number compared
+*/
+uint64_t nnue_check(int num_playouts, int max_plies, uint64_t seed, uint64_t* num_positions);
@@ -0,0 +1,709 @@
+/**
+ * @file pgn.c
+ * @brief Streaming reader for PGN files containing any number of games
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * The reader never copies the text of a game: tags and moves are handed out as slices
+ * pointing into either a memory-mapped file or a chunk buffer. Delimiters of comments,
+ * tag values and lines are found with memchr, which is vectorized by the C library.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pgn.h"
+#include "backend.h"
+#include "main.h"
+
+/*** Constants ***/
+
+const size_t pgn_chunk_size = 1 << 20;
+
+// Characters that end a SAN token or move number
+static const uint8_t delimiter[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1, ['\v'] = 1, ['\f'] = 1,
+    ['{'] = 1, ['}'] = 1, ['('] = 1, [')'] = 1, ['['] = 1, [']'] = 1,
+    [';'] = 1, ['$'] = 1, ['"'] = 1
+};
+
+static const uint8_t whitespace[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\r'] = 1, ['\v'] = 1, ['\f'] = 1
+};
+
+/*** Opening and closing ***/
+
+void _init_reader(struct Pgn_reader* reader) {
+    memset(reader, 0, sizeof(struct Pgn_reader));
+}
+
+int pgn_open(struct Pgn_reader* reader, const char* path) {
+    _init_reader(reader);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_msg("Error in pgn_open(): file does not exist", error);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+            close(fd);
+
+            reader->mapping = mapping;
+            reader->mapping_size = st.st_size;
+            reader->data = mapping;
+            reader->size = st.st_size;
+            reader->is_mapped = 1;
+            reader->eof = 1;
+            return 1;
+        }
+    }
+
+    // Not mappable (pipe, empty file, ...) -> read in chunks
+    FILE *file = fdopen(fd, "r");
+    if (file == NULL) {
+        close(fd);
+        return 0;
+    }
+
+    pgn_open_file(reader, file);
+    reader->owns_file = 1;
+    return 1;
+}
+
+void pgn_open_file(struct Pgn_reader* reader, FILE* file) {
+    _init_reader(reader);
+
+    reader->file = file;
+    reader->buffer_capacity = pgn_chunk_size;
+    reader->buffer = malloc(reader->buffer_capacity);
+    reader->data = reader->buffer;
+}
+
+void pgn_open_memory(struct Pgn_reader* reader, const char* data, size_t size) {
+    _init_reader(reader);
+
+    reader->data = data;
+    reader->size = size;
+    reader->is_mapped = 1;
+    reader->eof = 1;
+}
+
+void pgn_close(struct Pgn_reader* reader) {
+    if (reader->is_mapped && reader->mapping != NULL)
+        munmap(reader->mapping, reader->mapping_size);
+
+    if (reader->owns_file)
+        fclose(reader->file);
+
+    free(reader->buffer);
+    free(reader->tags);
+    free(reader->moves);
+
+    _init_reader(reader);
+}
+
+/*** Reading ***/
+
+/*
+* Read the next chunk, keeping everything not yet consumed.
+* returns: 0 if there is nothing left to read
+*/
+int _refill(struct Pgn_reader* reader) {
+    if (reader->eof)
+        return 0;
+
+    size_t remaining = reader->size - reader->cursor;
+    memmove(reader->buffer, reader->buffer + reader->cursor, remaining);
+    reader->size = remaining;
+    reader->cursor = 0;
+
+    // A single game larger than the buffer
+    if (reader->size == reader->buffer_capacity) {
+        reader->buffer_capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->buffer_capacity);
+    }
+    reader->data = reader->buffer;
+
+    size_t read = fread(reader->buffer + reader->size, 1, reader->buffer_capacity - reader->size, reader->file);
+    if (read == 0)
+        reader->eof = 1;
+
+    reader->size += read;
+    return 1;
+}
+
+void _push_tag(struct Pgn_reader* reader, struct Pgn_game* game, struct Pgn_tag tag) {
+    if (game->num_tags == reader->tags_capacity) {
+        reader->tags_capacity = reader->tags_capacity ? 2*reader->tags_capacity : 16;
+        reader->tags = realloc(reader->tags, sizeof(struct Pgn_tag) * reader->tags_capacity);
+    }
+    reader->tags[game->num_tags++] = tag;
+}
+
+void _push_move(struct Pgn_reader* reader, struct Pgn_game* game, struct Pgn_token move) {
+    if (game->num_moves == reader->moves_capacity) {
+        reader->moves_capacity = reader->moves_capacity ? 2*reader->moves_capacity : 256;
+        reader->moves = realloc(reader->moves, sizeof(struct Pgn_token) * reader->moves_capacity);
+    }
+    reader->moves[game->num_moves++] = move;
+}
+
+int _token_equals(const char* start, int length, const char* s) {
+    return (int)strlen(s) == length && !memcmp(start, s, length);
+}
+
+/*
+* Parse one game starting at the readers cursor
+* returns:
+*   1: game was parsed, cursor is behind it
+*   0: nothing but whitespace left
+*  -1: game continues past the end of the buffer, more data needed
+*/
+int _parse_game(struct Pgn_reader* reader, struct Pgn_game* game) {
+    const char *p = reader->data + reader->cursor;
+    const char *end = reader->data + reader->size;
+    const char *game_start = NULL;
+
+    int depth = 0;
+    int in_movetext = 0;
+
+    game->num_tags = 0;
+    game->num_moves = 0;
+    game->result = white;
+
+    while (p < end) {
+        unsigned char c = *p;
+
+        if (whitespace[c]) {
+            p++;
+            continue;
+        }
+
+        // UTF-8 byte order mark
+        if (c == 0xEF && end - p >= 3 && (unsigned char)p[1] == 0xBB && (unsigned char)p[2] == 0xBF) {
+            p += 3;
+            continue;
+        }
+
+        if (game_start == NULL)
+            game_start = p;
+
+        switch (c) {
+            case '[': {
+                // Tags of next game, this one had no result
+                if (in_movetext)
+                    goto done;
+
+                const char *q = p+1;
+                while (q < end && whitespace[(unsigned char)*q])
+                    q++;
+
+                struct Pgn_tag tag;
+                tag.name.start = q;
+                while (q < end && !delimiter[(unsigned char)*q])
+                    q++;
+                tag.name.length = q - tag.name.start;
+
+                const char *value = memchr(q, '"', end - q);
+                const char *close = memchr(q, ']', end - q);
+                if (close == NULL)
+                    goto incomplete;
+
+                // Tag without value
+                if (value == NULL || value > close) {
+                    tag.value.start = close;
+                    tag.value.length = 0;
+                    p = close+1;
+                }
+
+                else {
+                    value++;
+                    const char *value_end = value;
+                    for (;;) {
+                        value_end = memchr(value_end, '"', end - value_end);
+                        if (value_end == NULL)
+                            goto incomplete;
+
+                        // Count escaping backslashes
+                        int backslashes = 0;
+                        while (value_end - backslashes > value && value_end[-backslashes-1] == '\\')
+                            backslashes++;
+
+                        if (backslashes % 2 == 0)
+                            break;
+                        value_end++;
+                    }
+
+                    close = memchr(value_end, ']', end - value_end);
+                    if (close == NULL)
+                        goto incomplete;
+
+                    tag.value.start = value;
+                    tag.value.length = value_end - value;
+                    p = close+1;
+                }
+
+                _push_tag(reader, game, tag);
+            } break;
+
+            case '{': {
+                const char *q = memchr(p, '}', end - p);
+                if (q == NULL)
+                    goto incomplete;
+                p = q+1;
+            } break;
+
+            // Rest-of-line comment and escape
+            case ';': case '%': {
+                const char *q = memchr(p, '\n', end - p);
+                if (q == NULL) {
+                    if (!reader->eof)
+                        goto incomplete;
+                    q = end;
+                }
+                p = q;
+            } break;
+
+            case '(':
+                in_movetext = 1;
+                depth++;
+                p++;
+            break;
+
+            case ')':
+                if (depth > 0)
+                    depth--;
+                p++;
+            break;
+
+            case '*':
+                p++;
+                if (depth == 0) {
+                    game->result = white;
+                    goto done;
+                }
+            break;
+
+            default: {
+                const char *q = p;
+                if (c == '$')
+                    q++;
+                while (q < end && !delimiter[(unsigned char)*q])
+                    q++;
+
+                if (q == end && !reader->eof)
+                    goto incomplete;
+
+                // Stray delimiter like ']' or '"'
+                if (q == p) {
+                    p++;
+                    break;
+                }
+
+                const char *start = p;
+                int length = q - p;
+                p = q;
+                in_movetext = 1;
+
+                // NAG
+                if (c == '$')
+                    break;
+
+                if (depth == 0) {
+                    if (_token_equals(start, length, "1-0")) {
+                        game->result = white_win;
+                        goto done;
+                    }
+                    else if (_token_equals(start, length, "0-1")) {
+                        game->result = black_win;
+                        goto done;
+                    }
+                    else if (_token_equals(start, length, "1/2-1/2")) {
+                        game->result = draw;
+                        goto done;
+                    }
+                }
+
+                // Move number, possibly glued to the move ("12.e4")
+                if ('0' <= c && c <= '9') {
+                    int i = 0;
+                    while (i < length && '0' <= start[i] && start[i] <= '9')
+                        i++;
+
+                    // Not a move number after all (castling with zeroes)
+                    if (i < length && start[i] == '-')
+                        i = 0;
+                    else
+                        while (i < length && start[i] == '.')
+                            i++;
+
+                    start += i;
+                    length -= i;
+                }
+
+                // Annotations like "!?"
+                while (length > 0 && (start[length-1] == '!' || start[length-1] == '?'))
+                    length--;
+
+                if (depth == 0 && length > 0)
+                    _push_move(reader, game, (struct Pgn_token) {start, length});
+            } break;
+        }
+    }
+
+    // Reached the end of the buffer
+    if (!reader->eof)
+        goto incomplete;
+
+    if (game_start == NULL) {
+        reader->cursor = reader->size;
+        return 0;
+    }
+
+done:
+    game->tags = reader->tags;
+    game->moves = reader->moves;
+    game->text.start = game_start;
+    game->text.length = p - game_start;
+
+    reader->cursor = p - reader->data;
+    reader->games_read++;
+    return 1;
+
+incomplete:
+    // Whitespace in front of the game does not have to be kept around
+    if (game_start != NULL)
+        reader->cursor = game_start - reader->data;
+    else
+        reader->cursor = reader->size;
+    return -1;
+}
+
+int pgn_next_game(struct Pgn_reader* reader, struct Pgn_game* game) {
+    for (;;) {
+        int ret = _parse_game(reader, game);
+
+        if (ret != -1)
+            return ret;
+
+        // Truncated input, the last game can never be completed
+        if ( !_refill(reader) ) {
+            log_msg("Error in pgn_next_game(): Unexpected end of file", error);
+            reader->cursor = reader->size;
+            return 0;
+        }
+    }
+}
+
+long pgn_read_games(struct Pgn_reader* reader, int (*callback)(struct Pgn_game* game, void* data), void* data) {
+    struct Pgn_game game;
+    long num_games = 0;
+
+    while (pgn_next_game(reader, &game)) {
+        num_games++;
+
+        if (!callback(&game, data))
+            break;
+    }
+
+    return num_games;
+}
+
+const struct Pgn_token* pgn_find_tag(const struct Pgn_game* game, const char* name) {
+    for (int i = 0; i < game->num_tags; i++) {
+        const struct Pgn_tag *tag = &game->tags[i];
+        if (_token_equals(tag->name.start, tag->name.length, name))
+            return &tag->value;
+    }
+
+    return NULL;
+}
+
+/*** Replaying games ***/
+
+int pgn_move_string(const struct Pgn_token* token, char move[16]) {
+    int length = token->length;
+
+    // Check and mate markers are not needed to find the move
+    while (length > 0 && (token->start[length-1] == '+' || token->start[length-1] == '#'))
+        length--;
+
+    if (length == 0 || length > 7)
+        return 0;
+
+    memset(move, 0, 16);
+    memcpy(move, token->start, length);
+    return 1;
+}
+
+int replay_pgn_game(struct Game* game, const struct Pgn_game* pgn_game) {
+    char move[16];
+
+    for (int i = 0; i < pgn_game->num_moves; i++) {
+        if ( !pgn_move_string(&pgn_game->moves[i], move) ) {
+            log_msg("Error in replay_pgn_game(): Malformed move", error);
+            return 0;
+        }
+
+        if (game->halfmove + 1 >= game->max_moves)
+            resize_game(game, 2*game->max_moves);
+
+        if ( !eval_algebraic(game, move) ) {
+            log_msg("Error in replay_pgn_game(): Illegal move", error);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int load_pgn(struct Game* game, FILE* file) {
+    if(file == NULL) {
+        log_msg("Error in load_pgn(): file does not exist", error);
+        return 0;
+    }
+
+    log_msg("(pgn) Loading pgn file", log_info);
+
+    struct Pgn_reader reader;
+    struct Pgn_game pgn_game;
+    int ret = 0;
+
+    pgn_open_file(&reader, file);
+
+    if (pgn_next_game(&reader, &pgn_game))
+        ret = replay_pgn_game(game, &pgn_game);
+
+    pgn_close(&reader);
+
+    return ret;
+}
+
+/*** Writing ***/
+
+const size_t pgn_flush_size = 1 << 16;
+const int pgn_line_width = 80;
+
+void pgn_writer_open(struct Pgn_writer* writer, FILE* file) {
+    memset(writer, 0, sizeof(struct Pgn_writer));
+
+    writer->file = file;
+    writer->fullmove = 1;
+}
+
+int pgn_writer_flush(struct Pgn_writer* writer) {
+    if (writer->file == NULL || writer->size == 0)
+        return 1;
+
+    int ret = fwrite(writer->buffer, 1, writer->size, writer->file) == writer->size;
+    writer->size = 0;
+
+    if (!ret)
+        log_msg("Error in pgn_writer_flush(): could not write", error);
+
+    return ret;
+}
+
+int pgn_writer_close(struct Pgn_writer* writer) {
+    int ret = pgn_writer_flush(writer);
+
+    free(writer->buffer);
+    memset(writer, 0, sizeof(struct Pgn_writer));
+
+    return ret;
+}
+
+void pgn_write_raw(struct Pgn_writer* writer, const char* text, size_t length) {
+    if (writer->size + length > writer->capacity) {
+        while (writer->size + length > writer->capacity)
+            writer->capacity = writer->capacity ? 2*writer->capacity : 2*pgn_flush_size;
+
+        writer->buffer = realloc(writer->buffer, writer->capacity);
+    }
+
+    memcpy(writer->buffer + writer->size, text, length);
+    writer->size += length;
+
+    for (size_t i = 0; i < length; i++)
+        writer->column = (text[i] == '\n') ? 0 : writer->column + 1;
+
+    if (writer->file != NULL && writer->size >= pgn_flush_size)
+        pgn_writer_flush(writer);
+}
+
+void _write_tag(struct Pgn_writer* writer, const char* name, const char* value, int escape) {
+    writer->in_tags = 1;
+
+    pgn_write_raw(writer, "[", 1);
+    pgn_write_raw(writer, name, strlen(name));
+    pgn_write_raw(writer, " \"", 2);
+
+    while (*value != '\0') {
+        size_t length = escape ? strcspn(value, "\"\\") : strlen(value);
+        pgn_write_raw(writer, value, length);
+        value += length;
+
+        if (*value != '\0') {
+            pgn_write_raw(writer, "\\", 1);
+            pgn_write_raw(writer, value, 1);
+            value++;
+        }
+    }
+
+    pgn_write_raw(writer, "\"]\n", 3);
+}
+
+void pgn_write_tag(struct Pgn_writer* writer, const char* name, const char* value) {
+    _write_tag(writer, name, value, 1);
+}
+
+void pgn_write_raw_tag(struct Pgn_writer* writer, const char* name, const char* value) {
+    _write_tag(writer, name, value, 0);
+}
+
+/*
+* Write a movetext token, wrapping lines
+*/
+void _write_token(struct Pgn_writer* writer, const char* token, int length) {
+    // Empty line between tags and movetext
+    if (writer->in_tags) {
+        pgn_write_raw(writer, "\n", 1);
+        writer->in_tags = 0;
+    }
+
+    if (writer->attach)
+        writer->attach = 0;
+
+    else if (writer->column > 0) {
+        if (writer->column + 1 + length >= pgn_line_width)
+            pgn_write_raw(writer, "\n", 1);
+        else
+            pgn_write_raw(writer, " ", 1);
+    }
+
+    pgn_write_raw(writer, token, length);
+}
+
+void pgn_write_move(struct Pgn_writer* writer, struct Position* pos, struct Move move) {
+    struct Move moves[MAX_MOVES];
+    int num_moves = gen_move_list(pos, moves);
+
+    char token[32];
+    int length = 0;
+
+    if (pos->state == white)
+        length = sprintf(token, "%d.", writer->fullmove);
+    else if (!writer->in_movetext)
+        length = sprintf(token, "%d...", writer->fullmove);
+
+    if (length > 0)
+        _write_token(writer, token, length);
+
+    length = write_algebraic(pos, moves, num_moves, move, token);
+    _write_token(writer, token, length);
+
+    if (pos->state == black)
+        writer->fullmove++;
+    writer->in_movetext = 1;
+}
+
+void pgn_write_result(struct Pgn_writer* writer, enum Game_state result) {
+    switch (result) {
+        case white_win: _write_token(writer, "1-0", 3); break;
+        case black_win: _write_token(writer, "0-1", 3); break;
+        case draw:      _write_token(writer, "1/2-1/2", 7); break;
+        default:        _write_token(writer, "*", 1); break;
+    }
+
+    pgn_write_raw(writer, "\n\n", 2);
+
+    writer->in_movetext = 0;
+    writer->fullmove = 1;
+}
+
+void pgn_write_nag(struct Pgn_writer* writer, int nag) {
+    char token[8];
+    int length = snprintf(token, sizeof(token), "$%d", nag);
+
+    _write_token(writer, token, length);
+}
+
+void pgn_write_comment(struct Pgn_writer* writer, const char* text) {
+    char token[256];
+    int length = snprintf(token, sizeof(token), "{%s}", text);
+
+    if (length >= (int)sizeof(token))
+        length = sizeof(token) - 1;
+
+    _write_token(writer, token, length);
+
+    // The next black move needs its number again
+    writer->in_movetext = 0;
+}
+
+void pgn_write_variation(struct Pgn_writer* writer, struct Position* pos, const struct Move* moves, int num_moves, const char* comment) {
+    // Back to the number of the replaced move
+    int fullmove = writer->fullmove;
+    if (pos->state == black)
+        writer->fullmove--;
+
+    _write_token(writer, "(", 1);
+    writer->attach = 1;
+    writer->in_movetext = 0;
+
+    struct Position positions[2];
+    positions[0] = *pos;
+
+    for (int i = 0; i < num_moves; i++) {
+        pgn_write_move(writer, &positions[i % 2], moves[i]);
+        unsafe_play_move_to(&positions[i % 2], &positions[(i+1) % 2], moves[i].from, moves[i].to, moves[i].promote);
+
+        if (i == 0 && comment != NULL)
+            pgn_write_comment(writer, comment);
+    }
+
+    pgn_write_raw(writer, ")", 1);
+
+    writer->fullmove = fullmove;
+    writer->in_movetext = 0;
+}
+
+int pgn_write_game(struct Pgn_writer* writer, const struct Pgn_tag* tags, int num_tags, struct Game* game) {
+    char name[256];
+    char value[256];
+
+    for (int i = 0; i < num_tags; i++) {
+        snprintf(name, sizeof(name), "%.*s", tags[i].name.length, tags[i].name.start);
+        snprintf(value, sizeof(value), "%.*s", tags[i].value.length, tags[i].value.start);
+        pgn_write_tag(writer, name, value);
+    }
+
+    for (int i = 0; i < game->halfmove; i++) {
+        struct Move move;
+
+        if ( !find_move(&game->positions[i], &game->positions[i+1], &move) ) {
+            log_msg("Error in pgn_write_game(): positions are not connected by a move", error);
+            return 0;
+        }
+
+        pgn_write_move(writer, &game->positions[i], move);
+    }
+
+    pgn_write_result(writer, game->positions[game->halfmove].state);
+    return 1;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "backend.h"
+
+/*
+* A slice of the PGN text. Not null-terminated, points directly into the readers buffer
+*/
+struct Pgn_token {
+    const char *start;
+    int length;
+};
+
+/*
+* [name "value"], quotes are stripped but escape sequences are not resolved
+*/
+struct Pgn_tag {
+    struct Pgn_token name;
+    struct Pgn_token value;
+};
+
+/*
+* A single game as found in the PGN text.
+* moves only contains the SAN tokens of the main line; move numbers, comments, NAGs and
+* variations are skipped. result is white_win, black_win, draw or (for '*') white.
+*
+* All tokens stay valid until the next game is read from the same reader.
+*/
+struct Pgn_game {
+    struct Pgn_tag *tags;
+    int num_tags;
+
+    struct Pgn_token *moves;
+    int num_moves;
+
+    enum Game_state result;
+
+    // The complete text of the game, tags included
+    struct Pgn_token text;
+};
+
+/*
+* Streaming reader over a PGN source containing any number of games.
+* Regular files are memory-mapped, everything else (pipes, FILE*) is read in chunks.
+*/
+struct Pgn_reader {
+    const char *data;
+    size_t size;
+    size_t cursor;
+
+    // Memory-mapped / in-memory source
+    int is_mapped;
+    void *mapping;
+    size_t mapping_size;
+
+    // Chunked source
+    FILE *file;
+    int owns_file;
+    char *buffer;
+    size_t buffer_capacity;
+    int eof;
+
+    // Reused across games, so reading does not allocate once warmed up
+    struct Pgn_tag *tags;
+    int tags_capacity;
+    struct Pgn_token *moves;
+    int moves_capacity;
+
+    long games_read;
+};
+
+/*
+* Open the PGN file at path. Uses mmap if possible, otherwise falls back to chunked reading
+* returns: success of operation
+*/
+int pgn_open(struct Pgn_reader* reader, const char* path);
+
+/*
+* Read games from an already opened stream. The stream is not closed by pgn_close()
+*/
+void pgn_open_file(struct Pgn_reader* reader, FILE* file);
+
+/*
+* Read games from a block of memory, which has to outlive the reader
+*/
+void pgn_open_memory(struct Pgn_reader* reader, const char* data, size_t size);
+
+void pgn_close(struct Pgn_reader* reader);
+
+/*
+* Read the next game
+* returns: 1 if a game was read, 0 at the end of the input
+*/
+int pgn_next_game(struct Pgn_reader* reader, struct Pgn_game* game);
+
+/*
+* Call callback for every remaining game, until it returns 0
+* returns: number of games passed to callback
+*/
+long pgn_read_games(struct Pgn_reader* reader, int (*callback)(struct Pgn_game* game, void* data), void* data);
+
+/*
+* returns: value of tag name, or NULL if game has no such tag
+*/
+const struct Pgn_token* pgn_find_tag(const struct Pgn_game* game, const char* name);
+
+/*
+* Copy a move token into a null-terminated string for parse_algebraic(), dropping '+' and '#'
+* returns: success of operation
+*/
+int pgn_move_string(const struct Pgn_token* token, char move[16]);
+
+/*
+* Replay the moves of a parsed game. game has to be initialized, it is grown if needed
+* returns: success of operation
+*/
+int replay_pgn_game(struct Game* game, const struct Pgn_game* pgn_game);
+
+/*
+* Load the first game of a PGN file into game
+* returns: success of operation
+*/
+int load_pgn(struct Game* game, FILE* file);
+
+/*** Writing ***/
+
+/*
+* Buffered PGN output. Without a file everything stays in buffer, for the caller to
+* write out and reset
+*/
+struct Pgn_writer {
+    FILE *file;
+
+    char *buffer;
+    size_t size;
+    size_t capacity;
+
+    int column;
+    int in_tags;
+    int in_movetext;
+    int fullmove;
+
+    // The next token follows the last one without a space, after "("
+    int attach;
+};
+
+void pgn_writer_open(struct Pgn_writer* writer, FILE* file);
+
+/*
+* Flush and free the buffer. The file is not closed
+* returns: success of operation
+*/
+int pgn_writer_close(struct Pgn_writer* writer);
+
+/*
+* returns: success of operation
+*/
+int pgn_writer_flush(struct Pgn_writer* writer);
+
+/*
+* Append text as is
+*/
+void pgn_write_raw(struct Pgn_writer* writer, const char* text, size_t length);
+
+/*
+* Write a tag pair, escaping '"' and '\' in value
+*/
+void pgn_write_tag(struct Pgn_writer* writer, const char* name, const char* value);
+
+/*
+* Write a tag pair whose value is already escaped (as stored by the reader)
+*/
+void pgn_write_raw_tag(struct Pgn_writer* writer, const char* name, const char* value);
+
+/*
+* Write move, played in pos, in algebraic notation with move number where needed
+*/
+void pgn_write_move(struct Pgn_writer* writer, struct Position* pos, struct Move move);
+
+/*
+* Write the result token, ending the game
+*/
+void pgn_write_result(struct Pgn_writer* writer, enum Game_state result);
+
+/*
+* Write a numeric annotation glyph, e.g. 4 for "??"
+*/
+void pgn_write_nag(struct Pgn_writer* writer, int nag);
+
+/*
+* Write a comment in braces. text must not contain '}'
+*/
+void pgn_write_comment(struct Pgn_writer* writer, const char* text);
+
+/*
+* Write a variation of num_moves moves in parentheses, replacing the last move written,
+* which was played in pos. comment is written after its first move, may be NULL
+*/
+void pgn_write_variation(struct Pgn_writer* writer, struct Position* pos, const struct Move* moves, int num_moves, const char* comment);
+
+/*
+* Write tags and all moves of game up to its current halfmove. Unlike the tags of the
+* reader, tag values must be unescaped, they are escaped like by pgn_write_tag()
+* returns: success of operation
+*/
+int pgn_write_game(struct Pgn_writer* writer, const struct Pgn_tag* tags, int num_tags, struct Game* game);
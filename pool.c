@@ -0,0 +1,71 @@
+/**
+ * @file pool.c
+ * @brief Running independent work items on all cores
+ * @version 1.0
+ * @date 19.10.2026
+ */
+
+/*** Definitions ***/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+struct Pool {
+    int num_items;
+    int next_item;
+    pthread_mutex_t mutex;
+
+    void (*work)(int index, void* data);
+    void *data;
+};
+
+/*** Functions ***/
+
+int num_cores() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? cores : 1;
+}
+
+void* _worker(void* arg) {
+    struct Pool *pool = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        int index = pool->next_item++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (index >= pool->num_items)
+            return NULL;
+
+        pool->work(index, pool->data);
+    }
+}
+
+void parallel_for(int num_items, int num_threads, void (*work)(int index, void* data), void* data) {
+    if (num_threads <= 0)
+        num_threads = num_cores();
+    if (num_threads > num_items)
+        num_threads = num_items;
+
+    struct Pool pool = { num_items, 0, PTHREAD_MUTEX_INITIALIZER, work, data };
+
+    // Not worth spawning threads
+    if (num_threads <= 1) {
+        _worker(&pool);
+        return;
+    }
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+
+    for (int i = 0; i < num_threads; i++)
+        pthread_create(&threads[i], NULL, _worker, &pool);
+
+    for (int i = 0; i < num_threads; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+    pthread_mutex_destroy(&pool.mutex);
+}
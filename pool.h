@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+* returns: number of online cpu cores
+*/
+int num_cores();
+
+/*
+* Call work(index, data) for every index in [0, num_items), spread over num_threads
+* threads (0 = one per core). Returns when all items are done
+*/
+void parallel_for(int num_items, int num_threads, void (*work)(int index, void* data), void* data);
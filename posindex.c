@@ -0,0 +1,726 @@
+/**
+ * @file posindex.c
+ * @brief Finding the games of a database reaching a position, see posindex.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Building is an external merge sort. Every chunk of games is replayed into records of
+ * (key, game, ply), sorted, and appended to a file of runs. Runs are merged through a heap,
+ * reading each with a small buffer, at most POS_INDEX_FAN_IN at a time: as long as there
+ * are more, groups of them are merged into longer runs of a second file. In the last pass
+ * every group of equal keys becomes a posting list. Keys go to a third file and are
+ * appended to the index at the end.
+ */
+
+/*** Definitions ***/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "posindex.h"
+#include "backend.h"
+#include "db.h"
+#include "pool.h"
+#include "main.h"
+
+// Runs merged at once, bounding the memory of merging to 64 cursor buffers
+#define POS_INDEX_FAN_IN 64
+
+struct Pos_index_record {
+    uint64_t key;
+    uint32_t game;
+    uint16_t ply;
+
+    // 0 for positions, 1 for material signatures
+    uint16_t material;
+};
+
+struct Pos_index_run {
+    // In records, from the start of the file of runs
+    uint64_t offset;
+    uint64_t num_records;
+};
+
+struct Pos_index_job {
+    const struct Db *db;
+    int num_chunks;
+
+    // Guards runs_file, runs_size and failed
+    pthread_mutex_t lock;
+    FILE *runs_file;
+    uint64_t runs_size;
+    int failed;
+
+    // One per chunk, then fewer and longer ones after every merge pass
+    struct Pos_index_run *runs;
+    int num_runs;
+};
+
+/*
+* Reads a run of the file of runs, buffered
+*/
+struct Pos_index_cursor {
+    uint64_t next;
+    uint64_t end;
+
+    struct Pos_index_record *buffer;
+    int size;
+    int position;
+};
+
+/*
+* Merges up to POS_INDEX_FAN_IN runs through a heap of their cursors
+*/
+struct Pos_index_merge {
+    FILE *file;
+
+    struct Pos_index_cursor cursors[POS_INDEX_FAN_IN];
+    int num_cursors;
+
+    int heap[POS_INDEX_FAN_IN];
+    int heap_size;
+
+    // A run could not be read
+    int failed;
+};
+
+/*** Constants ***/
+
+const char pos_index_magic[8] = "CHESSPIX";
+const uint32_t pos_index_version = 1;
+
+// About 30 MB of records per thread
+const uint64_t pos_index_chunk_games = 16384;
+
+// Records buffered per run while merging, 64 KB
+const int pos_index_cursor_records = 4096;
+
+/*** Material ***/
+
+uint64_t material_signature(const struct Position* pos) {
+    int counts[10] = {0};
+
+    for (int square = 0; square < 64; square++) {
+        switch (pos->board[square]) {
+            case P: case P_passant: counts[0]++; break;
+            case N: counts[1]++; break;
+            case B: counts[2]++; break;
+            case R: counts[3]++; break;
+            case Q: counts[4]++; break;
+            case p: case p_passant: counts[5]++; break;
+            case n: counts[6]++; break;
+            case b: counts[7]++; break;
+            case r: counts[8]++; break;
+            case q: counts[9]++; break;
+            default: break;
+        }
+    }
+
+    uint64_t signature = 0;
+    for (int i = 0; i < 10; i++)
+        signature |= (uint64_t)(counts[i] < 15 ? counts[i] : 15) << (4 * i);
+
+    return signature;
+}
+
+int parse_material_signature(const char* s, uint64_t* signature) {
+    const char *pieces = "PNBRQpnbrq";
+    int counts[10] = {0};
+
+    for (; *s; s++) {
+        if (*s == 'K' || *s == 'k')
+            continue;
+
+        const char *piece = strchr(pieces, *s);
+        if (piece == NULL || ++counts[piece - pieces] > 15)
+            return 0;
+    }
+
+    *signature = 0;
+    for (int i = 0; i < 10; i++)
+        *signature |= (uint64_t)counts[i] << (4 * i);
+
+    return 1;
+}
+
+/*** Building ***/
+
+int _compare_pos_index_records(const void* a, const void* b) {
+    const struct Pos_index_record *x = a, *y = b;
+
+    if (x->material != y->material)
+        return (int)x->material - (int)y->material;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    if (x->game != y->game)
+        return x->game < y->game ? -1 : 1;
+    return (int)x->ply - (int)y->ply;
+}
+
+void _add_record(struct Pos_index_record** records, uint64_t* num_records, uint64_t* capacity, struct Pos_index_record record) {
+    if (*num_records == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 1 << 16;
+        *records = realloc(*records, sizeof(struct Pos_index_record) * *capacity);
+    }
+
+    (*records)[(*num_records)++] = record;
+}
+
+/*
+* Replay chunk index into a sorted run, keeping the first ply of a key in every game
+*/
+void _index_chunk(int index, void* data) {
+    struct Pos_index_job *job = data;
+
+    uint64_t first_game = index * pos_index_chunk_games;
+    uint64_t last_game = first_game + pos_index_chunk_games;
+    if (last_game > job->db->num_games)
+        last_game = job->db->num_games;
+
+    struct Pos_index_record *records = NULL;
+    uint64_t num_records = 0, capacity = 0;
+
+    for (uint64_t id = first_game; id < last_game; id++) {
+        int num_moves;
+        const uint16_t *moves = db_game_moves(job->db, id, &num_moves);
+
+        // Corrupt, left out of the index
+        if (moves == NULL)
+            continue;
+
+        if (num_moves > UINT16_MAX)
+            num_moves = UINT16_MAX;
+
+        struct Position positions[2];
+        positions[0] = starting_position;
+        uint64_t last_signature = 0;
+
+        for (int i = 0; i <= num_moves; i++) {
+            struct Position *crnt_pos = &positions[i % 2];
+
+            _add_record(&records, &num_records, &capacity,
+                (struct Pos_index_record) { hash_position(crnt_pos), id, i, 0 }
+            );
+
+            // Material never returns to an earlier signature, only changes are stored
+            uint64_t signature = material_signature(crnt_pos);
+            if (i == 0 || signature != last_signature)
+                _add_record(&records, &num_records, &capacity,
+                    (struct Pos_index_record) { signature, id, i, 1 }
+                );
+            last_signature = signature;
+
+            if (i == num_moves)
+                break;
+
+            struct Move move = decode_move(moves[i], crnt_pos->state);
+            unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+        }
+    }
+
+    qsort(records, num_records, sizeof(struct Pos_index_record), _compare_pos_index_records);
+
+    uint64_t unique = 0;
+    for (uint64_t i = 0; i < num_records; i++) {
+        if (unique > 0) {
+            struct Pos_index_record *last = &records[unique - 1];
+
+            if (last->material == records[i].material && last->key == records[i].key && last->game == records[i].game)
+                continue;
+        }
+
+        records[unique++] = records[i];
+    }
+
+    pthread_mutex_lock(&job->lock);
+
+    job->runs[index] = (struct Pos_index_run) { job->runs_size, unique };
+    job->runs_size += unique;
+
+    if (fwrite(records, sizeof(struct Pos_index_record), unique, job->runs_file) != unique)
+        job->failed = 1;
+
+    pthread_mutex_unlock(&job->lock);
+
+    free(records);
+}
+
+/*
+* Open a scratch file next to path, removed once closed
+*/
+FILE* _open_scratch_file(const char* path, const char* suffix) {
+    char scratch_path[4096];
+    snprintf(scratch_path, sizeof(scratch_path), "%s%s", path, suffix);
+
+    FILE *file = fopen(scratch_path, "w+b");
+    if (file != NULL)
+        unlink(scratch_path);
+
+    return file;
+}
+
+/*
+* returns: 1 if there are records left, 0 at the end of the run, -1 if it could not be read
+*/
+int _fill_cursor(FILE* file, struct Pos_index_cursor* cursor) {
+    if (cursor->position < cursor->size)
+        return 1;
+    if (cursor->next == cursor->end)
+        return 0;
+
+    uint64_t count = cursor->end - cursor->next;
+    if (count > (uint64_t)pos_index_cursor_records)
+        count = pos_index_cursor_records;
+
+    if (
+        fseeko(file, cursor->next * sizeof(struct Pos_index_record), SEEK_SET) != 0 ||
+        fread(cursor->buffer, sizeof(struct Pos_index_record), count, file) != count
+    ) {
+        log_msg("Error in build_pos_index(): could not read run", error);
+        cursor->next = cursor->end;
+        return -1;
+    }
+
+    cursor->next += count;
+    cursor->size = count;
+    cursor->position = 0;
+
+    return 1;
+}
+
+int _cursor_less(struct Pos_index_cursor* cursors, int a, int b) {
+    return _compare_pos_index_records(
+        &cursors[a].buffer[cursors[a].position], &cursors[b].buffer[cursors[b].position]
+    ) < 0;
+}
+
+/*
+* Restore the heap property below heap[i]
+*/
+void _sift_down(struct Pos_index_cursor* cursors, int* heap, int size, int i) {
+    for (;;) {
+        int smallest = i, left = 2*i + 1, right = 2*i + 2;
+
+        if (left < size && _cursor_less(cursors, heap[left], heap[smallest]))
+            smallest = left;
+        if (right < size && _cursor_less(cursors, heap[right], heap[smallest]))
+            smallest = right;
+
+        if (smallest == i)
+            return;
+
+        int tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+/*
+* Start merging num_runs runs of file, at most POS_INDEX_FAN_IN
+*/
+void _init_merge(struct Pos_index_merge* merge, FILE* file, const struct Pos_index_run* runs, int num_runs) {
+    memset(merge, 0, sizeof(struct Pos_index_merge));
+    merge->file = file;
+    merge->num_cursors = num_runs;
+
+    for (int i = 0; i < num_runs; i++) {
+        struct Pos_index_cursor *cursor = &merge->cursors[i];
+
+        cursor->next = runs[i].offset;
+        cursor->end = runs[i].offset + runs[i].num_records;
+        cursor->buffer = malloc(sizeof(struct Pos_index_record) * pos_index_cursor_records);
+
+        int filled = _fill_cursor(file, cursor);
+
+        if (filled > 0)
+            merge->heap[merge->heap_size++] = i;
+        merge->failed |= filled < 0;
+    }
+
+    for (int i = merge->heap_size / 2 - 1; i >= 0; i--)
+        _sift_down(merge->cursors, merge->heap, merge->heap_size, i);
+}
+
+/*
+* returns: whether there was a record left, stored in record
+*/
+int _merge_next(struct Pos_index_merge* merge, struct Pos_index_record* record) {
+    if (merge->heap_size == 0)
+        return 0;
+
+    struct Pos_index_cursor *cursor = &merge->cursors[merge->heap[0]];
+    *record = cursor->buffer[cursor->position++];
+
+    int filled = _fill_cursor(merge->file, cursor);
+
+    if (filled <= 0)
+        merge->heap[0] = merge->heap[--merge->heap_size];
+    merge->failed |= filled < 0;
+
+    _sift_down(merge->cursors, merge->heap, merge->heap_size, 0);
+    return 1;
+}
+
+void _delete_merge(struct Pos_index_merge* merge) {
+    for (int i = 0; i < merge->num_cursors; i++)
+        free(merge->cursors[i].buffer);
+}
+
+/*
+* Merge the runs of job in groups of POS_INDEX_FAN_IN into longer runs, moving
+* them between the file of runs and another scratch file, until one group is left
+* returns: success of operation
+*/
+int _reduce_runs(struct Pos_index_job* job, const char* index_path) {
+    if (job->num_runs <= POS_INDEX_FAN_IN)
+        return 1;
+
+    FILE *target = _open_scratch_file(index_path, ".runs2");
+    if (target == NULL)
+        return 0;
+
+    int ret = 1;
+
+    while (ret && job->num_runs > POS_INDEX_FAN_IN) {
+        int num_merged = 0;
+        uint64_t offset = 0;
+
+        ret = fseeko(target, 0, SEEK_SET) == 0;
+
+        for (int first = 0; ret && first < job->num_runs; first += POS_INDEX_FAN_IN) {
+            int count = job->num_runs - first < POS_INDEX_FAN_IN ? job->num_runs - first : POS_INDEX_FAN_IN;
+
+            struct Pos_index_merge merge;
+            struct Pos_index_record record;
+            _init_merge(&merge, job->runs_file, &job->runs[first], count);
+
+            struct Pos_index_run run = { offset, 0 };
+
+            while (ret && _merge_next(&merge, &record)) {
+                ret = fwrite(&record, sizeof(record), 1, target) == 1;
+                run.num_records++;
+            }
+
+            ret = ret && !merge.failed;
+            _delete_merge(&merge);
+
+            // Group g only reads from runs[g * POS_INDEX_FAN_IN] on, its run can go to runs[g]
+            job->runs[num_merged++] = run;
+            offset += run.num_records;
+        }
+
+        ret = ret && fflush(target) == 0;
+        job->num_runs = num_merged;
+
+        FILE *tmp = job->runs_file;
+        job->runs_file = target;
+        target = tmp;
+    }
+
+    // The file of runs is closed by build_pos_index()
+    if (target != job->runs_file)
+        fclose(target);
+
+    return ret;
+}
+
+/*
+* returns: number of bytes written, 0 if writing failed
+*/
+int _write_varint(FILE* file, uint64_t value) {
+    int length = 0;
+
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+
+        if (putc(value ? byte | 0x80 : byte, file) == EOF)
+            return 0;
+        length++;
+    } while (value);
+
+    return length;
+}
+
+/*
+* Merge the runs into posting lists in out, right after the header, and their keys into
+* keys_file
+* returns: success of operation
+*/
+int _merge_runs(struct Pos_index_job* job, FILE* out, FILE* keys_file, struct Pos_index_header* header, struct Pos_index_stats* stats) {
+    struct Pos_index_merge merge;
+    struct Pos_index_record record;
+    _init_merge(&merge, job->runs_file, job->runs, job->num_runs);
+
+    struct Pos_index_key key = {0};
+    int material = 0, have_key = 0, ret = 1;
+    uint64_t postings_size = 0, last_game = 0;
+
+    while (ret && _merge_next(&merge, &record)) {
+        if (!have_key || record.key != key.key || record.material != material) {
+            if (have_key) {
+                ret = fwrite(&key, sizeof(key), 1, keys_file) == 1;
+                material ? header->num_materials++ : header->num_positions++;
+            }
+
+            key = (struct Pos_index_key) { record.key, postings_size, 0 };
+            material = record.material;
+            have_key = 1;
+            last_game = 0;
+        }
+
+        int game_size = _write_varint(out, record.game - last_game);
+        int ply_size = _write_varint(out, record.ply);
+
+        ret = ret && game_size && ply_size;
+        postings_size += game_size + ply_size;
+        last_game = record.game;
+
+        key.num_postings++;
+        stats->postings++;
+    }
+
+    if (ret && have_key) {
+        ret = fwrite(&key, sizeof(key), 1, keys_file) == 1;
+        material ? header->num_materials++ : header->num_positions++;
+    }
+
+    ret = ret && !merge.failed;
+    _delete_merge(&merge);
+
+    // Keys are 8 byte aligned
+    while (ret && (sizeof(struct Pos_index_header) + postings_size) % 8) {
+        ret = putc(0, out) != EOF;
+        postings_size++;
+    }
+
+    header->keys_offset = sizeof(struct Pos_index_header) + postings_size;
+    return ret;
+}
+
+/*** Reading ***/
+
+int pos_index_open(struct Pos_index* index, const char* path) {
+    memset(index, 0, sizeof(struct Pos_index));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_msg("Error in pos_index_open(): file does not exist", error);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct Pos_index_header)) {
+        log_msg("Error in pos_index_open(): not a position index", error);
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        log_msg("Error in pos_index_open(): could not map file", error);
+        return 0;
+    }
+
+    // Queries touch a few pages anywhere in the file
+    madvise(mapping, st.st_size, MADV_RANDOM);
+
+    index->data = mapping;
+    index->size = st.st_size;
+    index->header = mapping;
+
+    const struct Pos_index_header *header = index->header;
+
+    if (
+        memcmp(header->magic, pos_index_magic, sizeof(pos_index_magic)) ||
+        header->version > pos_index_version ||
+        header->keys_offset < sizeof(struct Pos_index_header) ||
+        header->keys_offset > index->size ||
+        header->num_positions > (index->size - header->keys_offset) / sizeof(struct Pos_index_key) ||
+        header->num_materials > (index->size - header->keys_offset) / sizeof(struct Pos_index_key) - header->num_positions
+    ) {
+        log_msg("Error in pos_index_open(): not a position index or unsupported version", error);
+        pos_index_close(index);
+        return 0;
+    }
+
+    index->positions = (const struct Pos_index_key*)(index->data + header->keys_offset);
+    index->materials = index->positions + header->num_positions;
+    index->postings = (const unsigned char*)index->data + sizeof(struct Pos_index_header);
+    index->postings_size = header->keys_offset - sizeof(struct Pos_index_header);
+
+    return 1;
+}
+
+void pos_index_close(struct Pos_index* index) {
+    if (index->data != NULL)
+        munmap((void*)index->data, index->size);
+
+    memset(index, 0, sizeof(struct Pos_index));
+}
+
+/*
+* returns: success of operation
+*/
+int _read_varint(const unsigned char** p, const unsigned char* end, uint64_t* value) {
+    *value = 0;
+
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if ( !(byte & 0x80) )
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+* Binary search keys for key and decode at most max_postings of its postings
+*/
+uint64_t _find_postings(const struct Pos_index* index, const struct Pos_index_key* keys, uint64_t num_keys, uint64_t key, struct Pos_index_posting* postings, uint64_t max_postings) {
+    uint64_t low = 0, high = num_keys;
+
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+
+        if (keys[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low == num_keys || keys[low].key != key || keys[low].offset > index->postings_size)
+        return 0;
+
+    const unsigned char *p = index->postings + keys[low].offset;
+    const unsigned char *end = index->postings + index->postings_size;
+    uint64_t game = 0;
+
+    for (uint64_t i = 0; i < keys[low].num_postings && i < max_postings; i++) {
+        uint64_t delta, ply;
+
+        if ( !_read_varint(&p, end, &delta) || !_read_varint(&p, end, &ply) ) {
+            log_msg("Error in pos_index_find(): corrupt posting list", error);
+            return i;
+        }
+
+        game += delta;
+        postings[i] = (struct Pos_index_posting) { game, ply };
+    }
+
+    return keys[low].num_postings;
+}
+
+uint64_t pos_index_find(const struct Pos_index* index, const struct Position* pos, struct Pos_index_posting* postings, uint64_t max_postings) {
+    return _find_postings(index, index->positions, index->header->num_positions, hash_position(pos), postings, max_postings);
+}
+
+uint64_t pos_index_find_material(const struct Pos_index* index, uint64_t signature, struct Pos_index_posting* postings, uint64_t max_postings) {
+    return _find_postings(index, index->materials, index->header->num_materials, signature, postings, max_postings);
+}
+
+/*** Functions ***/
+
+int build_pos_index(const char* db_path, const char* index_path, int num_threads, struct Pos_index_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Pos_index_stats));
+
+    struct Db db;
+    if ( !db_open(&db, db_path) )
+        return 0;
+
+    if (db.num_games > UINT32_MAX) {
+        log_msg("Error in build_pos_index(): too many games", error);
+        db_close(&db);
+        return 0;
+    }
+
+    FILE *out = fopen(index_path, "wb");
+    FILE *runs_file = _open_scratch_file(index_path, ".runs");
+    FILE *keys_file = _open_scratch_file(index_path, ".keys");
+
+    if (out == NULL || runs_file == NULL || keys_file == NULL) {
+        log_msg("Error in build_pos_index(): could not open output files", error);
+
+        if (out) fclose(out);
+        if (runs_file) fclose(runs_file);
+        if (keys_file) fclose(keys_file);
+        db_close(&db);
+        return 0;
+    }
+
+    struct Pos_index_job job = {
+        .db = &db,
+        .num_chunks = (db.num_games + pos_index_chunk_games - 1) / pos_index_chunk_games,
+        .runs_file = runs_file
+    };
+    job.runs = malloc(sizeof(struct Pos_index_run) * (job.num_chunks ? job.num_chunks : 1));
+    pthread_mutex_init(&job.lock, NULL);
+
+    parallel_for(job.num_chunks, num_threads, _index_chunk, &job);
+    job.num_runs = job.num_chunks;
+
+    int ret = !job.failed && fflush(runs_file) == 0;
+    ret = ret && _reduce_runs(&job, index_path);
+
+    struct Pos_index_header header = { .version = pos_index_version, .num_games = db.num_games };
+    memcpy(header.magic, pos_index_magic, sizeof(pos_index_magic));
+
+    ret = ret && fwrite(&header, sizeof(header), 1, out) == 1;
+
+    if (ret) {
+        ret = _merge_runs(&job, out, keys_file, &header, stats);
+
+        // Append the keys
+        char buffer[1 << 16];
+        size_t size;
+
+        ret = ret && fflush(keys_file) == 0 && fseeko(keys_file, 0, SEEK_SET) == 0;
+
+        while (ret && (size = fread(buffer, 1, sizeof(buffer), keys_file)) > 0)
+            ret = fwrite(buffer, 1, size, out) == size;
+
+        ret = ret && !ferror(keys_file);
+        ret = ret && fseeko(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+    }
+
+    ret = (fclose(out) == 0) && ret;
+    fclose(job.runs_file);
+    fclose(keys_file);
+
+    if (!ret)
+        log_msg("Error in build_pos_index(): could not write index", error);
+
+    stats->games = db.num_games;
+    stats->positions = header.num_positions;
+    stats->materials = header.num_materials;
+    stats->runs = job.num_chunks;
+    stats->bytes = header.keys_offset + (header.num_positions + header.num_materials) * sizeof(struct Pos_index_key);
+
+    pthread_mutex_destroy(&job.lock);
+    free(job.runs);
+    db_close(&db);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Position index: for every position of a game database, the games reaching it and the
+* first ply they do so at. Next to the positions, games are indexed by their material
+* signature for queries on the material only, e.g. all rook endgames.
+*
+* Index files, version 1, host byte order like the database:
+*
+*   offset 0                struct Pos_index_header
+*   offset header size      posting lists, one after another
+*   offset keys_offset      struct Pos_index_key[num_positions], sorted by key, then
+*                           struct Pos_index_key[num_materials], sorted by key
+*
+* A posting list holds one (game id, ply) pair per game, ordered by game id. Both are
+* stored as LEB128 varints, the game id as difference to the previous one.
+*/
+struct Pos_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+
+    uint64_t num_games;
+    uint64_t num_positions;
+    uint64_t num_materials;
+    uint64_t keys_offset;
+};
+
+struct Pos_index_key {
+    // hash_position() or material_signature()
+    uint64_t key;
+
+    // Of the posting list, offset relative to the end of the header
+    uint64_t offset;
+    uint64_t num_postings;
+};
+
+struct Pos_index_posting {
+    uint64_t game;
+    uint32_t ply;
+};
+
+/*
+* An open, memory-mapped index
+*/
+struct Pos_index {
+    const char *data;
+    size_t size;
+
+    const struct Pos_index_header *header;
+    const struct Pos_index_key *positions;
+    const struct Pos_index_key *materials;
+    const unsigned char *postings;
+    size_t postings_size;
+};
+
+struct Pos_index_stats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t materials;
+    uint64_t postings;
+    uint64_t runs;
+
+    // Size of the index file
+    uint64_t bytes;
+    double seconds;
+};
+
+/*
+* Number of pieces of each kind but the kings, 4 bits each: PNBRQ for white, then black
+*/
+uint64_t material_signature(const struct Position* pos);
+
+/*
+* Parse a material signature like "KRPkr", kings being optional
+* returns: success of operation
+*/
+int parse_material_signature(const char* s, uint64_t* signature);
+
+/*
+* returns: success of operation
+*/
+int pos_index_open(struct Pos_index* index, const char* path);
+void pos_index_close(struct Pos_index* index);
+
+/*
+* Find the games reaching pos, storing at most max_postings of them in postings. Hash
+* collisions are possible, load the game to be sure
+* returns: number of games reaching pos
+*/
+uint64_t pos_index_find(const struct Pos_index* index, const struct Position* pos, struct Pos_index_posting* postings, uint64_t max_postings);
+
+/*
+* Same as pos_index_find() for the games reaching a material signature
+* returns: number of games reaching signature
+*/
+uint64_t pos_index_find_material(const struct Pos_index* index, uint64_t signature, struct Pos_index_posting* postings, uint64_t max_postings);
+
+/*
+* Index all games of the database at db_path. Chunks of games are replayed on num_threads
+* threads (0 = one per core), each sorted into a run of a temporary file, and the runs are
+* merged into the index at index_path. Memory use mostly depends on the number of threads,
+* not on the size of the database
+* returns: success of operation
+*/
+int build_pos_index(const char* db_path, const char* index_path, int num_threads, struct Pos_index_stats* stats);
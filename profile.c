@@ -0,0 +1,156 @@
+/**
+ * @file profile.c
+ * @brief Per thread cycle counters of the hot paths, see profile.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Each thread gets its own block of counters on its first timed call. Blocks are never
+ * freed, so the counters of finished threads still show up in the report.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "profile.h"
+
+#ifdef PROFILE
+
+struct Profile_thread {
+    struct Profile_counter counters[num_profile_zones];
+
+    // Cycles of the nested zones of the innermost open scope
+    uint64_t children;
+
+    struct Profile_thread *next;
+};
+
+/*** Constants ***/
+
+const char* profile_zone_names[num_profile_zones] = {
+    "gen_legal_moves",
+    "_check_for_check",
+    "in_check",
+    "_gen_legal_moves_castling",
+    "static_eval",
+    "gen_move_list"
+};
+
+/*** State ***/
+
+_Thread_local struct Profile_thread *profile_thread;
+
+struct Profile_thread *profile_threads;
+pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*** Timing ***/
+
+uint64_t _profile_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void _report_at_exit() {
+    profile_report(stderr);
+}
+
+struct Profile_thread* _register_thread() {
+    struct Profile_thread *thread = calloc(1, sizeof(struct Profile_thread));
+
+    pthread_mutex_lock(&profile_mutex);
+
+    if (profile_threads == NULL)
+        atexit(_report_at_exit);
+
+    thread->next = profile_threads;
+    profile_threads = thread;
+
+    pthread_mutex_unlock(&profile_mutex);
+
+    return thread;
+}
+
+struct Profile_scope _profile_begin(enum Profile_zone zone) {
+    if (profile_thread == NULL)
+        profile_thread = _register_thread();
+
+    struct Profile_scope scope = { zone, 0, profile_thread->children };
+    profile_thread->children = 0;
+
+    scope.start = profile_now();
+    return scope;
+}
+
+void _profile_end(struct Profile_scope* scope) {
+    uint64_t cycles = profile_now() - scope->start;
+    struct Profile_counter *counter = &profile_thread->counters[scope->zone];
+
+    counter->calls++;
+    counter->cycles += cycles;
+    counter->self_cycles += cycles - profile_thread->children;
+
+    profile_thread->children = scope->parent_children + cycles;
+}
+
+/*** Functions ***/
+
+void profile_report(FILE* file) {
+    struct Profile_counter total[num_profile_zones];
+    memset(total, 0, sizeof(total));
+
+    // Running threads may be counting meanwhile, which is fine for a report
+    pthread_mutex_lock(&profile_mutex);
+
+    for (struct Profile_thread *thread = profile_threads; thread != NULL; thread = thread->next) {
+        for (int zone = 0; zone < num_profile_zones; zone++) {
+            total[zone].calls += thread->counters[zone].calls;
+            total[zone].cycles += thread->counters[zone].cycles;
+            total[zone].self_cycles += thread->counters[zone].self_cycles;
+        }
+    }
+
+    pthread_mutex_unlock(&profile_mutex);
+
+    uint64_t all_self_cycles = 0;
+    for (int zone = 0; zone < num_profile_zones; zone++)
+        all_self_cycles += total[zone].self_cycles;
+
+    // Recursive zones count nested calls twice in cycles, but not in self cycles
+    fprintf(file, "%-26s %12s %16s %16s %12s %7s\n", "zone", "calls", "cycles", "self cycles", "self/call", "self %");
+
+    for (int zone = 0; zone < num_profile_zones; zone++) {
+        struct Profile_counter *counter = &total[zone];
+
+        fprintf(file, "%-26s %12llu %16llu %16llu %12.0f %6.1f%%\n",
+            profile_zone_names[zone], (unsigned long long)counter->calls,
+            (unsigned long long)counter->cycles, (unsigned long long)counter->self_cycles,
+            counter->calls ? (double)counter->self_cycles / counter->calls : 0.0,
+            all_self_cycles ? 100.0 * counter->self_cycles / all_self_cycles : 0.0
+        );
+    }
+}
+
+void profile_reset() {
+    pthread_mutex_lock(&profile_mutex);
+
+    for (struct Profile_thread *thread = profile_threads; thread != NULL; thread = thread->next)
+        memset(thread->counters, 0, sizeof(thread->counters));
+
+    pthread_mutex_unlock(&profile_mutex);
+}
+
+#else
+
+void profile_report(FILE* file) {
+    fprintf(file, "profiling disabled, build with -DPROFILE\n");
+}
+
+void profile_reset() {}
+
+#endif
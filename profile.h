@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+* Cycle counting of the hot paths, enabled by building with -DPROFILE. Otherwise
+* profile_scope() expands to nothing and the functions below do nothing.
+*
+* A function is timed from profile_scope() to its return, whichever return that is.
+* Counters are kept per thread and summed up by profile_report(), which also runs at exit
+*/
+enum Profile_zone {
+    zone_gen_legal_moves,
+    zone_check_for_check,
+    zone_in_check,
+    zone_castling,
+    zone_static_eval,
+    zone_gen_move_list,
+    num_profile_zones
+};
+
+struct Profile_counter {
+    uint64_t calls;
+
+    // Including and excluding the time spent in nested zones
+    uint64_t cycles;
+    uint64_t self_cycles;
+};
+
+#ifdef PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define profile_now() __rdtsc()
+#else
+#define profile_now() _profile_now_ns()
+uint64_t _profile_now_ns();
+#endif
+
+struct Profile_scope {
+    enum Profile_zone zone;
+    uint64_t start;
+
+    // Cycles of the nested zones of the enclosing scope
+    uint64_t parent_children;
+};
+
+#define profile_scope(zone) \
+    struct Profile_scope _profile_scope __attribute__((cleanup(_profile_end))) = _profile_begin(zone)
+
+struct Profile_scope _profile_begin(enum Profile_zone zone);
+void _profile_end(struct Profile_scope* scope);
+
+#else
+
+#define profile_scope(zone) do {} while (0)
+
+#endif
+
+/*
+* Print calls and cycles of all zones, summed up over all threads
+*/
+void profile_report(FILE* file);
+
+/*
+* Zero the counters of all threads
+*/
+void profile_reset();
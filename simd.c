@@ -0,0 +1,299 @@
+/**
+ * @file simd.c
+ * @brief Vectorized board summation kernels of the evaluation, see simd.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * The vector kernels are compiled with target attributes, so the rest of the program
+ * does not need to be built for a particular CPU. Pieces are counted by comparing the
+ * packed board against every kind of piece, the worth of occupied squares by masking
+ * the byte table and summing with psadbw. Nothing is looked up through the board.
+ */
+
+/*** Definitions ***/
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#else
+#define HAVE_X86_KERNELS 0
+#endif
+
+#include "simd.h"
+#include "main.h"
+
+typedef int (*Board_terms_fn)(const enum Piece board[64], const uint8_t worth[64], int counts[15]);
+typedef void (*Board_values_batch_fn)(const struct Board_batch* batch, const struct Board_table* table, int* out);
+
+struct Eval_kernel {
+    const char *name;
+    int (*supported)();
+    Board_terms_fn board_terms;
+    Board_values_batch_fn board_values_batch;
+};
+
+// The vector kernels pack the board by narrowing 32 bit integers
+_Static_assert(sizeof(enum Piece) == 4, "enum Piece has to be 32 bits wide");
+
+/*** Portable ***/
+
+const int kernel_side[15] = {
+    0,
+    1, 1, 1, 1, 1, 1, 1,
+    -1, -1, -1, -1, -1, -1, -1
+};
+
+int _board_terms_portable(const enum Piece board[64], const uint8_t worth[64], int counts[15]) {
+    int sum = 0;
+    memset(counts, 0, sizeof(int) * 15);
+
+    for (int square = 0; square < 64; square++) {
+        counts[board[square]]++;
+        sum += kernel_side[board[square]] * worth[square];
+    }
+
+    return sum;
+}
+
+void _board_values_batch_portable(const struct Board_batch* batch, const struct Board_table* table, int* out) {
+    int sums[BOARD_BATCH] = {0};
+
+    for (int square = 0; square < 64; square++) {
+        for (int i = 0; i < BOARD_BATCH; i++)
+            sums[i] += table->values[square][ batch->squares[square][i] ];
+    }
+
+    memcpy(out, sums, sizeof(int) * batch->num_boards);
+}
+
+int _always_supported() {
+    return 1;
+}
+
+#if HAVE_X86_KERNELS
+
+/*** SSE4.1 ***/
+
+__attribute__((target("sse4.1,popcnt")))
+int _board_terms_sse4(const enum Piece board[64], const uint8_t worth[64], int counts[15]) {
+    const __m128i *in = (const __m128i*)board;
+    __m128i packed[4];
+
+    for (int i = 0; i < 4; i++) {
+        __m128i low = _mm_packs_epi32(_mm_loadu_si128(in + 4*i), _mm_loadu_si128(in + 4*i + 1));
+        __m128i high = _mm_packs_epi32(_mm_loadu_si128(in + 4*i + 2), _mm_loadu_si128(in + 4*i + 3));
+        packed[i] = _mm_packus_epi16(low, high);
+    }
+
+    __m128i white_sum = _mm_setzero_si128(), black_sum = _mm_setzero_si128();
+
+    for (int i = 0; i < 4; i++) {
+        __m128i weights = _mm_loadu_si128((const __m128i*)worth + i);
+        __m128i white_mask = _mm_and_si128(_mm_cmpgt_epi8(packed[i], _mm_set1_epi8(o)), _mm_cmplt_epi8(packed[i], _mm_set1_epi8(p)));
+        __m128i black_mask = _mm_cmpgt_epi8(packed[i], _mm_set1_epi8(K));
+
+        white_sum = _mm_add_epi64(white_sum, _mm_sad_epu8(_mm_and_si128(white_mask, weights), _mm_setzero_si128()));
+        black_sum = _mm_add_epi64(black_sum, _mm_sad_epu8(_mm_and_si128(black_mask, weights), _mm_setzero_si128()));
+    }
+
+    __m128i diff = _mm_sub_epi64(white_sum, black_sum);
+    int sum = _mm_cvtsi128_si32(diff) + _mm_cvtsi128_si32(_mm_srli_si128(diff, 8));
+
+    int occupied = 0;
+
+    for (int piece = P; piece <= k; piece++) {
+        __m128i kind = _mm_set1_epi8(piece);
+        int count = 0;
+
+        for (int i = 0; i < 4; i++)
+            count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(packed[i], kind)));
+
+        counts[piece] = count;
+        occupied += count;
+    }
+
+    counts[o] = 64 - occupied;
+    return sum;
+}
+
+int _sse4_supported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+}
+
+/*** AVX2 ***/
+
+__attribute__((target("avx2,popcnt")))
+int _board_terms_avx2(const enum Piece board[64], const uint8_t worth[64], int counts[15]) {
+    const __m256i *in = (const __m256i*)board;
+
+    // Narrowing works within 128 bit lanes, the permutation restores the square order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i packed[2];
+
+    for (int i = 0; i < 2; i++) {
+        __m256i low = _mm256_packs_epi32(_mm256_loadu_si256(in + 4*i), _mm256_loadu_si256(in + 4*i + 1));
+        __m256i high = _mm256_packs_epi32(_mm256_loadu_si256(in + 4*i + 2), _mm256_loadu_si256(in + 4*i + 3));
+        packed[i] = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), order);
+    }
+
+    __m256i white_sum = _mm256_setzero_si256(), black_sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < 2; i++) {
+        __m256i weights = _mm256_loadu_si256((const __m256i*)worth + i);
+        __m256i white_mask = _mm256_and_si256(_mm256_cmpgt_epi8(packed[i], _mm256_set1_epi8(o)), _mm256_cmpgt_epi8(_mm256_set1_epi8(p), packed[i]));
+        __m256i black_mask = _mm256_cmpgt_epi8(packed[i], _mm256_set1_epi8(K));
+
+        white_sum = _mm256_add_epi64(white_sum, _mm256_sad_epu8(_mm256_and_si256(white_mask, weights), _mm256_setzero_si256()));
+        black_sum = _mm256_add_epi64(black_sum, _mm256_sad_epu8(_mm256_and_si256(black_mask, weights), _mm256_setzero_si256()));
+    }
+
+    __m256i diff = _mm256_sub_epi64(white_sum, black_sum);
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(diff), _mm256_extracti128_si256(diff, 1));
+    int sum = _mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8));
+
+    int occupied = 0;
+
+    for (int piece = P; piece <= k; piece++) {
+        __m256i kind = _mm256_set1_epi8(piece);
+        int count = __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(packed[0], kind)))
+                  + __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(packed[1], kind)));
+
+        counts[piece] = count;
+        occupied += count;
+    }
+
+    counts[o] = 64 - occupied;
+    return sum;
+}
+
+/*
+* 15 entry table lookups of 8 boards at once, from two registers of 8 entries
+*/
+__attribute__((target("avx2")))
+void _board_values_batch_avx2(const struct Board_batch* batch, const struct Board_table* table, int* out) {
+    const __m256i seven = _mm256_set1_epi32(7);
+    __m256i sums[BOARD_BATCH / 8];
+
+    for (int j = 0; j < BOARD_BATCH / 8; j++)
+        sums[j] = _mm256_setzero_si256();
+
+    for (int square = 0; square < 64; square++) {
+        __m256i low = _mm256_loadu_si256((const __m256i*)table->values[square]);
+        __m256i high = _mm256_loadu_si256((const __m256i*)(table->values[square] + 8));
+
+        for (int j = 0; j < BOARD_BATCH / 8; j++) {
+            __m256i pieces = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(batch->squares[square] + 8*j)));
+
+            // Only the lowest 3 bits select, the comparison picks the register
+            __m256i values = _mm256_blendv_epi8(
+                _mm256_permutevar8x32_epi32(low, pieces),
+                _mm256_permutevar8x32_epi32(high, pieces),
+                _mm256_cmpgt_epi32(pieces, seven)
+            );
+
+            sums[j] = _mm256_add_epi32(sums[j], values);
+        }
+    }
+
+    int32_t result[BOARD_BATCH];
+
+    for (int j = 0; j < BOARD_BATCH / 8; j++)
+        _mm256_storeu_si256((__m256i*)(result + 8*j), sums[j]);
+
+    memcpy(out, result, sizeof(int) * batch->num_boards);
+}
+
+int _avx2_supported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+#endif
+
+/*** Constants ***/
+
+// Fastest first
+const struct Eval_kernel eval_kernels[] = {
+#if HAVE_X86_KERNELS
+    { "avx2", _avx2_supported, _board_terms_avx2, _board_values_batch_avx2 },
+    { "sse4", _sse4_supported, _board_terms_sse4, _board_values_batch_portable },
+#endif
+    { "portable", _always_supported, _board_terms_portable, _board_values_batch_portable }
+};
+
+const int num_eval_kernels = sizeof(eval_kernels) / sizeof(eval_kernels[0]);
+
+/*** State ***/
+
+const struct Eval_kernel *eval_kernel;
+pthread_once_t eval_kernel_once = PTHREAD_ONCE_INIT;
+
+/*** Functions ***/
+
+void _detect_eval_kernel() {
+    for (int i = 0; i < num_eval_kernels && eval_kernel == NULL; i++) {
+        if ( eval_kernels[i].supported() )
+            eval_kernel = &eval_kernels[i];
+    }
+
+    log_printf(log_info, "(simd) Using %s evaluation kernel", eval_kernel->name);
+}
+
+int board_terms(const enum Piece board[64], const uint8_t worth[64], int counts[15]) {
+    pthread_once(&eval_kernel_once, _detect_eval_kernel);
+    return eval_kernel->board_terms(board, worth, counts);
+}
+
+void init_board_table(struct Board_table* table, const int material[15], const uint8_t worth[64]) {
+    memset(table, 0, sizeof(struct Board_table));
+
+    for (int square = 0; square < 64; square++) {
+        for (int piece = o; piece <= k; piece++)
+            table->values[square][piece] = material[piece] + kernel_side[piece] * worth[square];
+    }
+}
+
+void pack_board_batch(const struct Position* positions, int num_positions, struct Board_batch* batch) {
+    batch->num_boards = num_positions < BOARD_BATCH ? num_positions : BOARD_BATCH;
+
+    // Unused lanes hold empty boards
+    memset(batch->squares, o, sizeof(batch->squares));
+
+    for (int i = 0; i < batch->num_boards; i++) {
+        for (int square = 0; square < 64; square++)
+            batch->squares[square][i] = positions[i].board[square];
+    }
+}
+
+void board_values_batch(const struct Board_batch* batch, const struct Board_table* table, int* out) {
+    pthread_once(&eval_kernel_once, _detect_eval_kernel);
+    eval_kernel->board_values_batch(batch, table, out);
+}
+
+const char* eval_kernel_name() {
+    pthread_once(&eval_kernel_once, _detect_eval_kernel);
+    return eval_kernel->name;
+}
+
+int select_eval_kernel(const char* name) {
+    pthread_once(&eval_kernel_once, _detect_eval_kernel);
+
+    if ( !strcmp(name, "auto") ) {
+        eval_kernel = NULL;
+        _detect_eval_kernel();
+        return 1;
+    }
+
+    for (int i = 0; i < num_eval_kernels; i++) {
+        if ( !strcmp(eval_kernels[i].name, name) && eval_kernels[i].supported() ) {
+            eval_kernel = &eval_kernels[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Board summation kernels of the evaluation. The board is packed into 64 bytes and
+* summed up with SIMD instructions where the CPU supports them (AVX2, SSE4.1), otherwise
+* with a portable loop. The kernel is chosen on first use, by CPU feature detection.
+*
+* All kernels give the same results.
+*/
+
+#define BOARD_BATCH 32
+
+/*
+* Boards in structure-of-arrays layout: squares[square][i] is the piece on square of
+* board i, so SIMD lanes work on different boards
+*/
+struct Board_batch {
+    uint8_t squares[64][BOARD_BATCH];
+    int num_boards;
+};
+
+/*
+* Worth of every piece on every square, indexed by enum Piece (padded to 16)
+*/
+struct Board_table {
+    int32_t values[64][16];
+};
+
+/*
+* Count the pieces of every kind on board into counts, indexed by enum Piece (counts[o]
+* is the number of empty squares)
+* returns: sum of worth over the squares of white pieces minus the squares of black pieces
+*/
+int board_terms(const enum Piece board[64], const uint8_t worth[64], int counts[15]);
+
+/*
+* Fill table with material[piece] plus worth[square] for white pieces, minus it for black
+* pieces
+*/
+void init_board_table(struct Board_table* table, const int material[15], const uint8_t worth[64]);
+
+/*
+* Pack up to BOARD_BATCH positions into batch
+*/
+void pack_board_batch(const struct Position* positions, int num_positions, struct Board_batch* batch);
+
+/*
+* Sum up the table values of all squares of every board in batch into out, with
+* batch->num_boards entries
+*/
+void board_values_batch(const struct Board_batch* batch, const struct Board_table* table, int* out);
+
+/*
+* returns: name of the kernel in use
+*/
+const char* eval_kernel_name();
+
+/*
+* Use the kernel called name, e.g. to compare them. "auto" picks the fastest one
+* the CPU supports
+* returns: success of operation, fails if the CPU lacks the instructions
+*/
+int select_eval_kernel(const char* name);
@@ -0,0 +1,1081 @@
+/**
+ * @file tb.c
+ * @brief Generating and probing endgame tablebases, see tb.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Generation works on its own small piece lists instead of struct Position, as
+ * gen_legal_moves() is far too slow to visit millions of positions a hundred times.
+ *
+ * 1. Every position is classified once: mates, stalemates and the results of all
+ *    captures and promotions, which lead into smaller or already generated tables.
+ *    The distinct moves staying inside the table are counted.
+ * 2. Pass n takes all positions decided with n-1 halfmoves to mate and walks their
+ *    predecessors (unmoves). Predecessors of a loss are wins, predecessors of a win lose
+ *    once all their moves are known to lose.
+ *
+ * Passes only read values decided in earlier passes, so results do not depend on the
+ * order in which threads visit positions.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tb.h"
+#include "backend.h"
+#include "pool.h"
+#include "main.h"
+
+#define TB_MAX_PIECES 4
+#define TB_MAX_TABLES 64
+#define TB_MAX_CHILDREN 128
+#define TB_ILLEGAL 255
+
+struct Tb_table {
+    char name[16];
+    int num_pieces;
+    enum Piece pieces[TB_MAX_PIECES];
+    int has_pawns;
+    uint64_t num_positions;
+
+    const unsigned char *mapping;
+    size_t size;
+    const uint8_t *wdl;
+    const uint8_t *dtm;
+};
+
+/*
+* The pieces of a position in the order of a table. state is white or black
+*/
+struct Tb_position {
+    int num_pieces;
+    enum Piece pieces[TB_MAX_PIECES];
+    int squares[TB_MAX_PIECES];
+    int state;
+};
+
+struct Tb_generator {
+    struct Tb_table *table;
+
+    // Encoded like the dtm section of a table
+    atomic_uchar *values;
+
+    // Distinct moves staying inside the table, not yet known to lose
+    atomic_uchar *counts;
+
+    // Longest mate after a capture or promotion, TB_ILLEGAL if one of them does not lose
+    uint8_t *exit_max;
+
+    atomic_int max_value;
+    atomic_int missing;
+    int pass;
+};
+
+/*** Constants ***/
+
+const char tb_magic[8] = "CHESSTB";
+const uint32_t tb_version = 1;
+
+// In the order they have to be generated in
+const char* tb_names[] = {
+    "KQvK", "KRvK", "KBvK", "KNvK", "KPvK",
+
+    "KQQvK", "KQRvK", "KQBvK", "KQNvK", "KRRvK", "KRBvK", "KRNvK", "KBBvK", "KBNvK", "KNNvK",
+    "KQvKQ", "KQvKR", "KQvKB", "KQvKN", "KRvKR", "KRvKB", "KRvKN", "KBvKB", "KBvKN", "KNvKN",
+
+    "KQvKP", "KRvKP", "KBvKP", "KNvKP",
+    "KQPvK", "KRPvK", "KBPvK", "KNPvK", "KPPvK"
+};
+
+const int tb_num_names = sizeof(tb_names) / sizeof(tb_names[0]);
+
+// Squares of the white king in pawnless tables
+const int tb_triangle[10] = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+
+const uint64_t tb_chunk_size = 1 << 16;
+
+const int8_t tb_king_steps[8][2] = {
+    {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}
+};
+
+const int8_t tb_knight_jumps[8][2] = {
+    {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}
+};
+
+/*** State ***/
+
+struct Tb_table tb_tables[TB_MAX_TABLES];
+int tb_num_tables;
+
+/*** Pieces ***/
+
+int _is_black_piece(enum Piece piece) {
+    return piece >= p;
+}
+
+/*
+* K, Q, R, B, N, P as 0 to 5, regardless of color
+*/
+int _piece_order(enum Piece piece) {
+    switch (piece) {
+        case K: case k: return 0;
+        case Q: case q: return 1;
+        case R: case r: return 2;
+        case B: case b: return 3;
+        case N: case n: return 4;
+        default: return 5;
+    }
+}
+
+enum Piece _piece_of_letter(char c, int black) {
+    const enum Piece pieces[2][6] = {
+        { K, Q, R, B, N, P },
+        { k, q, r, b, n, p }
+    };
+
+    const char *letters = "KQRBNP";
+    const char *letter = strchr(letters, c);
+
+    return (letter != NULL && c != '\0') ? pieces[black][letter - letters] : o;
+}
+
+/*** Tables ***/
+
+int _parse_name(const char* name, struct Tb_table* table) {
+    memset(table, 0, sizeof(struct Tb_table));
+
+    if (strlen(name) >= sizeof(table->name))
+        return 0;
+    strcpy(table->name, name);
+
+    int black = 0, kings = 0;
+
+    for (const char *c = name; *c != '\0'; c++) {
+        if (*c == 'v' && !black) {
+            black = 1;
+            continue;
+        }
+
+        enum Piece piece = _piece_of_letter(*c, black);
+        if (piece == o || table->num_pieces == TB_MAX_PIECES)
+            return 0;
+
+        // Kings come first on each side
+        if ( (_piece_order(piece) == 0) != (c == name || c[-1] == 'v') )
+            return 0;
+
+        kings += _piece_order(piece) == 0;
+        table->has_pawns |= piece == P || piece == p;
+        table->pieces[table->num_pieces++] = piece;
+    }
+
+    if (!black || kings != 2)
+        return 0;
+
+    table->num_positions = (table->has_pawns ? 32 : 10) * 2;
+    for (int i = 1; i < table->num_pieces; i++)
+        table->num_positions *= 64;
+
+    return 1;
+}
+
+struct Tb_table* _find_table(const char* name) {
+    for (int i = 0; i < tb_num_tables; i++) {
+        if ( !strcmp(tb_tables[i].name, name) )
+            return &tb_tables[i];
+    }
+
+    return NULL;
+}
+
+int _map_table(const char* dir, const char* name) {
+    if (tb_num_tables == TB_MAX_TABLES || _find_table(name) != NULL)
+        return 0;
+
+    struct Tb_table table;
+    if ( !_parse_name(name, &table) )
+        return 0;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.tb", dir, name);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct Tb_header)) {
+        log_printf(error, "Error in _map_table(): %s is not a table", path);
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        log_printf(error, "Error in _map_table(): could not map %s", path);
+        return 0;
+    }
+
+    const struct Tb_header *header = mapping;
+
+    if (
+        memcmp(header->magic, tb_magic, sizeof(tb_magic)) || header->version != tb_version ||
+        header->num_positions != table.num_positions ||
+        header->wdl_offset + (table.num_positions + 3) / 4 > (uint64_t)st.st_size ||
+        header->dtm_offset + table.num_positions > (uint64_t)st.st_size
+    ) {
+        log_printf(error, "Error in _map_table(): %s is not a table or has an unsupported version", path);
+        munmap(mapping, st.st_size);
+        return 0;
+    }
+
+    table.mapping = mapping;
+    table.size = st.st_size;
+    table.wdl = (const uint8_t*)mapping + header->wdl_offset;
+    table.dtm = (const uint8_t*)mapping + header->dtm_offset;
+
+    tb_tables[tb_num_tables++] = table;
+    return 1;
+}
+
+void _unmap_tables() {
+    for (int i = 0; i < tb_num_tables; i++)
+        munmap((void*)tb_tables[i].mapping, tb_tables[i].size);
+
+    tb_num_tables = 0;
+}
+
+/*** Indexing ***/
+
+/*
+* flags: 1 mirror files, 2 mirror ranks, 4 mirror along the a1-h8 diagonal, in this order
+*/
+int _transform(int square, int flags) {
+    int file = square % 8;
+    int rank = square / 8;
+
+    if (flags & 1)
+        file = 7 - file;
+    if (flags & 2)
+        rank = 7 - rank;
+    if (flags & 4) {
+        int tmp = file;
+        file = rank;
+        rank = tmp;
+    }
+
+    return 8*rank + file;
+}
+
+uint64_t _index(const struct Tb_table* table, const struct Tb_position* pos) {
+    int king = pos->squares[0];
+    int flags = (king % 8 > 3);
+
+    if (!table->has_pawns) {
+        if (king / 8 > 3)
+            flags |= 2;
+
+        int mirrored = _transform(king, flags);
+        if (mirrored / 8 > mirrored % 8)
+            flags |= 4;
+
+        // With the king on the diagonal, the first piece off it decides
+        for (int i = 1; i < pos->num_pieces && mirrored / 8 == mirrored % 8; i++) {
+            int square = _transform(pos->squares[i], flags);
+
+            if (square / 8 != square % 8) {
+                flags |= (square / 8 > square % 8) ? 4 : 0;
+                break;
+            }
+        }
+    }
+
+    king = _transform(king, flags);
+
+    uint64_t index = 0;
+    if (table->has_pawns)
+        index = 4*(king / 8) + king % 8;
+    else {
+        while (tb_triangle[index] != king)
+            index++;
+    }
+
+    for (int i = 1; i < pos->num_pieces; i++)
+        index = 64*index + _transform(pos->squares[i], flags);
+
+    return 2*index + pos->state;
+}
+
+/*
+* returns: if index is a possible placement of the pieces, ignoring checks
+*/
+int _decode(const struct Tb_table* table, uint64_t index, struct Tb_position* pos) {
+    pos->num_pieces = table->num_pieces;
+    memcpy(pos->pieces, table->pieces, sizeof(pos->pieces));
+
+    pos->state = index % 2;
+    index /= 2;
+
+    for (int i = table->num_pieces - 1; i > 0; i--) {
+        pos->squares[i] = index % 64;
+        index /= 64;
+    }
+
+    // Only the square of the first piece is left
+    int first = index;
+    pos->squares[0] = table->has_pawns ? 8*(first / 4) + first % 4 : tb_triangle[first];
+
+    for (int i = 0; i < pos->num_pieces; i++) {
+        int rank = pos->squares[i] / 8;
+
+        if ( (pos->pieces[i] == P || pos->pieces[i] == p) && (rank == 0 || rank == 7) )
+            return 0;
+
+        for (int j = 0; j < i; j++) {
+            if (pos->squares[i] == pos->squares[j])
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*** Moves ***/
+
+void _occupancy(const struct Tb_position* pos, int board[64]) {
+    for (int square = 0; square < 64; square++)
+        board[square] = -1;
+
+    for (int i = 0; i < pos->num_pieces; i++)
+        board[pos->squares[i]] = i;
+}
+
+int _attacks(const struct Tb_position* pos, const int board[64], int i, int target) {
+    int from = pos->squares[i];
+    int df = target % 8 - from % 8;
+    int dr = target / 8 - from / 8;
+    int adf = df < 0 ? -df : df;
+    int adr = dr < 0 ? -dr : dr;
+
+    switch (_piece_order(pos->pieces[i])) {
+        case 0:
+            return adf <= 1 && adr <= 1 && (adf || adr);
+        case 4:
+            return (adf == 1 && adr == 2) || (adf == 2 && adr == 1);
+        case 5:
+            return adf == 1 && dr == (_is_black_piece(pos->pieces[i]) ? -1 : 1);
+    }
+
+    int order = _piece_order(pos->pieces[i]);
+    int straight = (df == 0) != (dr == 0);
+    int diagonal = adf == adr && adf != 0;
+
+    if ( !( (straight && order != 3) || (diagonal && order != 2) ) )
+        return 0;
+
+    int step = (df > 0) - (df < 0) + 8*((dr > 0) - (dr < 0));
+
+    for (int square = from + step; square != target; square += step) {
+        if (board[square] >= 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+int _attacked(const struct Tb_position* pos, const int board[64], int square, int by_black) {
+    for (int i = 0; i < pos->num_pieces; i++) {
+        if (_is_black_piece(pos->pieces[i]) == by_black && _attacks(pos, board, i, square))
+            return 1;
+    }
+
+    return 0;
+}
+
+int _king_square(const struct Tb_position* pos, int black) {
+    for (int i = 0; i < pos->num_pieces; i++) {
+        if (pos->pieces[i] == (black ? k : K))
+            return pos->squares[i];
+    }
+
+    return -1;
+}
+
+/*
+* returns: if the king of black (or white) is attacked
+*/
+int _in_check(const struct Tb_position* pos, int black) {
+    int board[64];
+    _occupancy(pos, board);
+
+    return _attacked(pos, board, _king_square(pos, black), !black);
+}
+
+/*
+* Squares piece i can reach, ignoring checks. With captures unset, only empty squares,
+* pawns moving backwards
+*/
+int _destinations(const struct Tb_position* pos, const int board[64], int i, int captures, int* squares) {
+    int from = pos->squares[i];
+    int black = _is_black_piece(pos->pieces[i]);
+    int order = _piece_order(pos->pieces[i]);
+    int num_squares = 0;
+
+    if (order == 5) {
+        int forward = (black == !captures) ? 8 : -8;
+        int start_rank = black ? (captures ? 6 : 4) : (captures ? 1 : 3);
+        int one = from + forward;
+
+        // Pawns never stand on the first or last rank before moving
+        if (one < 0 || one >= 64 || board[one] >= 0 || (!captures && (one / 8 == 0 || one / 8 == 7)))
+            return 0;
+
+        squares[num_squares++] = one;
+
+        if (from / 8 == start_rank && board[one + forward] < 0)
+            squares[num_squares++] = one + forward;
+
+        if (captures) {
+            for (int side = -1; side <= 1; side += 2) {
+                int file = from % 8 + side;
+                int target = one + side;
+
+                if (file >= 0 && file < 8 && board[target] >= 0 && _is_black_piece(pos->pieces[board[target]]) != black)
+                    squares[num_squares++] = target;
+            }
+        }
+
+        return num_squares;
+    }
+
+    const int8_t (*directions)[2] = (order == 4) ? tb_knight_jumps : tb_king_steps;
+    int sliding = order >= 1 && order <= 3;
+
+    for (int d = 0; d < 8; d++) {
+        int straight = directions[d][0] == 0 || directions[d][1] == 0;
+
+        if ( (order == 2 && !straight) || (order == 3 && straight) )
+            continue;
+
+        int file = from % 8, rank = from / 8;
+
+        for (;;) {
+            file += directions[d][0];
+            rank += directions[d][1];
+
+            if (file < 0 || file >= 8 || rank < 0 || rank >= 8)
+                break;
+
+            int square = 8*rank + file;
+
+            if (board[square] >= 0) {
+                if (captures && _is_black_piece(pos->pieces[board[square]]) != black)
+                    squares[num_squares++] = square;
+                break;
+            }
+
+            squares[num_squares++] = square;
+
+            if (!sliding)
+                break;
+        }
+    }
+
+    return num_squares;
+}
+
+void _remove_piece(struct Tb_position* pos, int i) {
+    for (int j = i; j < pos->num_pieces - 1; j++) {
+        pos->pieces[j] = pos->pieces[j+1];
+        pos->squares[j] = pos->squares[j+1];
+    }
+
+    pos->num_pieces--;
+}
+
+/*
+* Legal moves of the side to move. Moves staying inside the table go to quiet, captures
+* and promotions to exits
+*/
+void _gen_moves(const struct Tb_position* pos, struct Tb_position* quiet, int* num_quiet, struct Tb_position* exits, int* num_exits) {
+    int board[64];
+    _occupancy(pos, board);
+
+    *num_quiet = 0;
+    *num_exits = 0;
+
+    for (int i = 0; i < pos->num_pieces; i++) {
+        if (_is_black_piece(pos->pieces[i]) != pos->state)
+            continue;
+
+        int squares[32];
+        int num_squares = _destinations(pos, board, i, 1, squares);
+
+        for (int j = 0; j < num_squares; j++) {
+            int target = board[squares[j]];
+
+            // Only possible in illegal positions
+            if (target >= 0 && _piece_order(pos->pieces[target]) == 0)
+                continue;
+
+            struct Tb_position child = *pos;
+            child.squares[i] = squares[j];
+            child.state = !pos->state;
+
+            int promotion = _piece_order(pos->pieces[i]) == 5 && (squares[j] / 8 == 0 || squares[j] / 8 == 7);
+            int mover = i;
+
+            if (target >= 0) {
+                _remove_piece(&child, target);
+                mover -= target < i;
+            }
+
+            if (_in_check(&child, pos->state))
+                continue;
+
+            if (!promotion && target < 0) {
+                quiet[(*num_quiet)++] = child;
+                continue;
+            }
+
+            if (!promotion) {
+                exits[(*num_exits)++] = child;
+                continue;
+            }
+
+            const enum Piece promotions[2][4] = { { Q, R, B, N }, { q, r, b, n } };
+
+            for (int m = 0; m < 4; m++) {
+                child.pieces[mover] = promotions[pos->state][m];
+                exits[(*num_exits)++] = child;
+            }
+        }
+    }
+}
+
+/*
+* Positions from which the side not to move could have reached pos without capturing
+*/
+int _gen_unmoves(const struct Tb_position* pos, struct Tb_position* predecessors) {
+    int board[64];
+    _occupancy(pos, board);
+
+    int num_predecessors = 0;
+
+    for (int i = 0; i < pos->num_pieces; i++) {
+        if (_is_black_piece(pos->pieces[i]) == pos->state)
+            continue;
+
+        int squares[32];
+        int num_squares = _destinations(pos, board, i, 0, squares);
+
+        for (int j = 0; j < num_squares; j++) {
+            struct Tb_position predecessor = *pos;
+            predecessor.squares[i] = squares[j];
+            predecessor.state = !pos->state;
+
+            // The side not to move may not be in check
+            if ( !_in_check(&predecessor, pos->state) )
+                predecessors[num_predecessors++] = predecessor;
+        }
+    }
+
+    return num_predecessors;
+}
+
+/*** Probing ***/
+
+/*
+* Find the table of pos and bring pos into its order, swapping colors if needed
+*/
+struct Tb_table* _lookup(const struct Tb_position* pos, struct Tb_position* ordered) {
+    char names[2][TB_MAX_PIECES + 1];
+    int indices[2][TB_MAX_PIECES];
+    int counts[2] = {0, 0};
+
+    // Insertion sort by piece order, per color
+    for (int i = 0; i < pos->num_pieces; i++) {
+        int color = _is_black_piece(pos->pieces[i]);
+        int j = counts[color]++;
+
+        while (j > 0 && _piece_order(pos->pieces[indices[color][j-1]]) > _piece_order(pos->pieces[i])) {
+            indices[color][j] = indices[color][j-1];
+            j--;
+        }
+        indices[color][j] = i;
+    }
+
+    for (int color = 0; color < 2; color++) {
+        for (int j = 0; j < counts[color]; j++)
+            names[color][j] = "KQRBNP"[_piece_order(pos->pieces[indices[color][j]])];
+        names[color][counts[color]] = '\0';
+    }
+
+    for (int flip = 0; flip < 2; flip++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%sv%s", names[flip], names[!flip]);
+
+        struct Tb_table *table = _find_table(name);
+        if (table == NULL)
+            continue;
+
+        ordered->num_pieces = 0;
+        ordered->state = pos->state ^ flip;
+
+        for (int side = 0; side < 2; side++) {
+            int color = side ^ flip;
+
+            for (int j = 0; j < counts[color]; j++) {
+                int i = indices[color][j];
+                enum Piece piece = pos->pieces[i];
+
+                // Colors swap, so do the ranks
+                if (flip)
+                    piece = _is_black_piece(piece) ? piece - 7 : piece + 7;
+
+                ordered->pieces[ordered->num_pieces] = piece;
+                ordered->squares[ordered->num_pieces++] = flip ? pos->squares[i] ^ 56 : pos->squares[i];
+            }
+        }
+
+        return table;
+    }
+
+    return NULL;
+}
+
+/*
+* returns: value of pos as in the dtm section, TB_ILLEGAL if there is no table
+*/
+uint8_t _probe_value(const struct Tb_position* pos) {
+    // Bare kings
+    if (pos->num_pieces == 2)
+        return 0;
+
+    struct Tb_position ordered;
+    struct Tb_table *table = _lookup(pos, &ordered);
+
+    return table ? table->dtm[_index(table, &ordered)] : TB_ILLEGAL;
+}
+
+/*
+* returns: if pos can be looked up at all
+*/
+int _tb_position(struct Position* pos, struct Tb_position* tb_pos) {
+    if (
+        tb_num_tables == 0 ||
+        pos->white_can_castle_king || pos->white_can_castle_queen ||
+        pos->black_can_castle_king || pos->black_can_castle_queen
+    ) {
+        return 0;
+    }
+
+    tb_pos->num_pieces = 0;
+    tb_pos->state = pos->state;
+
+    for (int square = 0; square < 64; square++) {
+        enum Piece piece = pos->board[square];
+
+        if (piece == o)
+            continue;
+        if (tb_pos->num_pieces == TB_MAX_PIECES)
+            return 0;
+
+        // Tables never have pawns on both sides, so en passant does not matter
+        if (piece == P_passant)
+            piece = P;
+        else if (piece == p_passant)
+            piece = p;
+
+        tb_pos->pieces[tb_pos->num_pieces] = piece;
+        tb_pos->squares[tb_pos->num_pieces++] = square;
+    }
+
+    return 1;
+}
+
+int tb_probe(struct Position* pos, int* wdl, int* dtm) {
+    struct Tb_position tb_pos;
+
+    if ( !_tb_position(pos, &tb_pos) )
+        return 0;
+
+    uint8_t value = _probe_value(&tb_pos);
+
+    if (value == TB_ILLEGAL)
+        return 0;
+
+    *dtm = value ? value - 1 : 0;
+    *wdl = value ? (*dtm % 2 ? 1 : -1) : 0;
+
+    return 1;
+}
+
+int tb_probe_wdl(struct Position* pos, int* wdl) {
+    struct Tb_position tb_pos, ordered;
+
+    if ( !_tb_position(pos, &tb_pos) )
+        return 0;
+
+    if (tb_pos.num_pieces == 2) {
+        *wdl = 0;
+        return 1;
+    }
+
+    struct Tb_table *table = _lookup(&tb_pos, &ordered);
+    if (table == NULL)
+        return 0;
+
+    uint64_t index = _index(table, &ordered);
+    int value = (table->wdl[index / 4] >> (2 * (index % 4))) & 3;
+
+    if (value == 3)
+        return 0;
+
+    *wdl = (value == 1) - (value == 2);
+    return 1;
+}
+
+/*** Generation ***/
+
+void _update_max_value(struct Tb_generator* generator, int value) {
+    int max = atomic_load(&generator->max_value);
+
+    while (value > max && !atomic_compare_exchange_weak(&generator->max_value, &max, value))
+        ;
+}
+
+/*
+* Sort out duplicates, which mirrored positions produce
+* returns: number of distinct indices
+*/
+int _distinct_indices(const struct Tb_table* table, const struct Tb_position* positions, int num_positions, uint64_t* indices) {
+    int num_indices = 0;
+
+    for (int i = 0; i < num_positions; i++) {
+        uint64_t index = _index(table, &positions[i]);
+        int duplicate = 0;
+
+        for (int j = 0; j < num_indices && !duplicate; j++)
+            duplicate = indices[j] == index;
+
+        if (!duplicate)
+            indices[num_indices++] = index;
+    }
+
+    return num_indices;
+}
+
+void _classify_chunk(int chunk, void* data) {
+    struct Tb_generator *generator = data;
+    struct Tb_table *table = generator->table;
+
+    uint64_t start = chunk * tb_chunk_size;
+    uint64_t end = start + tb_chunk_size < table->num_positions ? start + tb_chunk_size : table->num_positions;
+
+    struct Tb_position quiet[TB_MAX_CHILDREN], exits[TB_MAX_CHILDREN];
+    uint64_t indices[TB_MAX_CHILDREN];
+
+    for (uint64_t index = start; index < end; index++) {
+        struct Tb_position pos;
+
+        // Mirrored twins of other indices are never used
+        if ( !_decode(table, index, &pos) || _index(table, &pos) != index || _in_check(&pos, !pos.state) ) {
+            atomic_store_explicit(&generator->values[index], TB_ILLEGAL, memory_order_relaxed);
+            continue;
+        }
+
+        int num_quiet, num_exits;
+        _gen_moves(&pos, quiet, &num_quiet, exits, &num_exits);
+
+        int num_children = _distinct_indices(table, quiet, num_quiet, indices);
+
+        int fastest_win = 0, exit_max = 0, cannot_lose = 0;
+
+        for (int i = 0; i < num_exits; i++) {
+            uint8_t value = _probe_value(&exits[i]);
+
+            if (value == TB_ILLEGAL)
+                atomic_fetch_add(&generator->missing, 1);
+
+            // Draw
+            else if (value == 0)
+                cannot_lose = 1;
+
+            // Loss of the opponent, a win in one more halfmove
+            else if ((value - 1) % 2 == 0) {
+                if (fastest_win == 0 || value < fastest_win)
+                    fastest_win = value;
+            }
+
+            else if (value - 1 > exit_max)
+                exit_max = value - 1;
+        }
+
+        int value = 0;
+
+        if (num_quiet + num_exits == 0)
+            value = _in_check(&pos, pos.state) ? 1 : 0;
+        else if (fastest_win)
+            value = fastest_win + 1;
+        else if (num_children == 0 && !cannot_lose)
+            value = exit_max + 2;
+
+        atomic_store_explicit(&generator->values[index], value, memory_order_relaxed);
+        atomic_store_explicit(&generator->counts[index], num_children, memory_order_relaxed);
+        generator->exit_max[index] = cannot_lose ? TB_ILLEGAL : exit_max;
+
+        _update_max_value(generator, value);
+    }
+}
+
+void _pass_chunk(int chunk, void* data) {
+    struct Tb_generator *generator = data;
+    struct Tb_table *table = generator->table;
+
+    uint64_t start = chunk * tb_chunk_size;
+    uint64_t end = start + tb_chunk_size < table->num_positions ? start + tb_chunk_size : table->num_positions;
+
+    struct Tb_position predecessors[TB_MAX_CHILDREN];
+    uint64_t indices[TB_MAX_CHILDREN];
+
+    int dtm = generator->pass - 1;
+
+    for (uint64_t index = start; index < end; index++) {
+        if (atomic_load_explicit(&generator->values[index], memory_order_relaxed) != generator->pass)
+            continue;
+
+        struct Tb_position pos;
+        _decode(table, index, &pos);
+
+        int num_predecessors = _gen_unmoves(&pos, predecessors);
+        int num_indices = _distinct_indices(table, predecessors, num_predecessors, indices);
+
+        for (int i = 0; i < num_indices; i++) {
+            atomic_uchar *value = &generator->values[indices[i]];
+            unsigned char old = atomic_load_explicit(value, memory_order_relaxed);
+
+            // Moving into a loss wins
+            if (dtm % 2 == 0) {
+                while ( old == 0 || (old != TB_ILLEGAL && (old - 1) % 2 == 1 && old > dtm + 2) ) {
+                    if ( atomic_compare_exchange_weak_explicit(value, &old, dtm + 2, memory_order_relaxed, memory_order_relaxed) ) {
+                        _update_max_value(generator, dtm + 2);
+                        break;
+                    }
+                }
+            }
+
+            // Moving into a win loses, once there is nothing better
+            else if (old == 0) {
+                int left = atomic_fetch_sub_explicit(&generator->counts[indices[i]], 1, memory_order_relaxed) - 1;
+                int exit_max = generator->exit_max[indices[i]];
+
+                if (left == 0 && exit_max != TB_ILLEGAL) {
+                    int loss = (dtm > exit_max ? dtm : exit_max) + 1;
+
+                    if (loss + 1 >= TB_ILLEGAL) {
+                        log_msg("Error in _pass_chunk(): mate too long to be stored", error);
+                        continue;
+                    }
+
+                    atomic_store_explicit(value, loss + 1, memory_order_relaxed);
+                    _update_max_value(generator, loss + 1);
+                }
+            }
+        }
+
+    }
+}
+
+int _write_table(const char* dir, struct Tb_generator* generator) {
+    struct Tb_table *table = generator->table;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.tb", dir, table->name);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        log_printf(error, "Error in _write_table(): could not open %s", path);
+        return 0;
+    }
+
+    uint64_t wdl_size = (table->num_positions + 3) / 4;
+
+    struct Tb_header header = {0};
+    memcpy(header.magic, tb_magic, sizeof(tb_magic));
+    header.version = tb_version;
+    header.num_pieces = table->num_pieces;
+    strcpy(header.name, table->name);
+    header.num_positions = table->num_positions;
+    header.wdl_offset = sizeof(struct Tb_header);
+    header.dtm_offset = (header.wdl_offset + wdl_size + 7) / 8 * 8;
+
+    int ret = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    uint8_t *buffer = malloc(tb_chunk_size);
+
+    // Win/draw/loss
+    for (uint64_t start = 0; start < table->num_positions; start += 4 * tb_chunk_size) {
+        uint64_t end = start + 4 * tb_chunk_size < table->num_positions ? start + 4 * tb_chunk_size : table->num_positions;
+        memset(buffer, 0, tb_chunk_size);
+
+        for (uint64_t index = start; index < end; index++) {
+            int value = atomic_load_explicit(&generator->values[index], memory_order_relaxed);
+            int wdl = (value == TB_ILLEGAL) ? 3 : (value == 0) ? 0 : ((value - 1) % 2 ? 1 : 2);
+
+            buffer[(index - start) / 4] |= wdl << (2 * (index % 4));
+        }
+
+        ret = ret && fwrite(buffer, 1, (end - start + 3) / 4, file) == (end - start + 3) / 4;
+    }
+
+    const char padding[8] = {0};
+    ret = ret && fwrite(padding, 1, header.dtm_offset - header.wdl_offset - wdl_size, file) == header.dtm_offset - header.wdl_offset - wdl_size;
+
+    // Distance to mate
+    for (uint64_t start = 0; start < table->num_positions; start += tb_chunk_size) {
+        uint64_t end = start + tb_chunk_size < table->num_positions ? start + tb_chunk_size : table->num_positions;
+
+        for (uint64_t index = start; index < end; index++)
+            buffer[index - start] = atomic_load_explicit(&generator->values[index], memory_order_relaxed);
+
+        ret = ret && fwrite(buffer, 1, end - start, file) == end - start;
+    }
+
+    free(buffer);
+    ret = (fclose(file) == 0) && ret;
+
+    if (!ret)
+        log_printf(error, "Error in _write_table(): could not write %s", path);
+
+    return ret;
+}
+
+int _generate_table(const char* dir, const char* name, int num_threads, struct Tb_stats* stats) {
+    struct Tb_table table;
+    if ( !_parse_name(name, &table) ) {
+        log_printf(error, "Error in _generate_table(): %s is not a valid table", name);
+        return 0;
+    }
+
+    log_printf(log_info, "(tb) Generating %s", name);
+
+    struct Tb_generator generator = {
+        .table = &table,
+        .values = malloc(sizeof(atomic_uchar) * table.num_positions),
+        .counts = malloc(sizeof(atomic_uchar) * table.num_positions),
+        .exit_max = malloc(table.num_positions)
+    };
+    atomic_init(&generator.max_value, 0);
+    atomic_init(&generator.missing, 0);
+
+    int num_chunks = (table.num_positions + tb_chunk_size - 1) / tb_chunk_size;
+    int ret = 1;
+
+    parallel_for(num_chunks, num_threads, _classify_chunk, &generator);
+
+    if (atomic_load(&generator.missing) > 0) {
+        log_printf(error, "Error in _generate_table(): %s needs tables that do not exist", name);
+        ret = 0;
+    }
+
+    for (generator.pass = 1; ret && generator.pass <= atomic_load(&generator.max_value) && generator.pass < TB_ILLEGAL; generator.pass++)
+        parallel_for(num_chunks, num_threads, _pass_chunk, &generator);
+
+    ret = ret && _write_table(dir, &generator);
+
+    if (ret) {
+        int longest_mate = atomic_load(&generator.max_value) > 0 ? atomic_load(&generator.max_value) - 1 : 0;
+
+        stats->tables++;
+        stats->positions += table.num_positions;
+
+        if (longest_mate > stats->longest_mate) {
+            stats->longest_mate = longest_mate;
+            strcpy(stats->longest_mate_table, name);
+        }
+
+        printf("%-8s %10llu positions, longest mate %d halfmoves\n", name, (unsigned long long)table.num_positions, longest_mate);
+        fflush(stdout);
+
+        // Needed by the tables that follow
+        _map_table(dir, name);
+    }
+
+    free(generator.values);
+    free(generator.counts);
+    free(generator.exit_max);
+
+    return ret;
+}
+
+/*** Functions ***/
+
+int tb_init(const char* dir) {
+    _unmap_tables();
+
+    for (int i = 0; i < tb_num_names; i++)
+        _map_table(dir, tb_names[i]);
+
+    if (tb_num_tables > 0)
+        log_printf(log_info, "(tb) Mapped %d tables", tb_num_tables);
+
+    return tb_num_tables;
+}
+
+int tb_max_pieces() {
+    int max_pieces = 0;
+
+    for (int i = 0; i < tb_num_tables; i++) {
+        if (tb_tables[i].num_pieces > max_pieces)
+            max_pieces = tb_tables[i].num_pieces;
+    }
+
+    return max_pieces;
+}
+
+int tb_generate(const char* dir, const char** names, int num_names, int num_threads, struct Tb_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Tb_stats));
+
+    if (num_names == 0) {
+        names = tb_names;
+        num_names = tb_num_names;
+    }
+
+    mkdir(dir, 0755);
+    tb_init(dir);
+
+    int ret = 1;
+
+    for (int i = 0; i < num_names && ret; i++) {
+        // Replaced by the new one
+        struct Tb_table *old = _find_table(names[i]);
+        if (old != NULL) {
+            munmap((void*)old->mapping, old->size);
+            *old = tb_tables[--tb_num_tables];
+        }
+
+        ret = _generate_table(dir, names[i], num_threads, stats);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
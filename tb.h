@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "backend.h"
+
+/*
+* Endgame tablebases for up to 4 pieces, kings included, generated by retrograde analysis.
+* Supported are all pawnless endings and endings in which only one side has pawns
+* (KPvK, KRvKP, KPPvK, ...). Pawns on both sides would need en passant, which the tables
+* do not know.
+*
+* Every table is a file <dir>/<name>.tb, e.g. tb/KQvKR.tb, version 1:
+*
+*   offset 0                struct Tb_header
+*   offset wdl_offset       num_positions 2 bit values, 4 per byte, lowest bits first:
+*                           0 draw, 1 win, 2 loss, 3 illegal (for the side to move)
+*   offset dtm_offset       num_positions bytes: 0 draw, 255 illegal, otherwise 1 + the
+*                           number of halfmoves until mate. Odd distances are wins
+*
+* A position is indexed by the squares of its pieces, in the order of the name (white
+* first), and the side to move. The white king is mirrored to files a-d, and for pawnless
+* tables into the triangle a1-d1-d4.
+*/
+struct Tb_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_pieces;
+
+    char name[16];
+    uint64_t num_positions;
+
+    uint64_t wdl_offset;
+    uint64_t dtm_offset;
+};
+
+struct Tb_stats {
+    int tables;
+    uint64_t positions;
+
+    // Longest mate over all tables, in halfmoves
+    int longest_mate;
+    char longest_mate_table[16];
+
+    double seconds;
+};
+
+extern const char* tb_names[];
+extern const int tb_num_names;
+
+/*
+* Map all tables found in dir, replacing the ones mapped before
+* returns: number of tables found
+*/
+int tb_init(const char* dir);
+
+/*
+* returns: number of pieces of the largest mapped table, 0 if none are mapped
+*/
+int tb_max_pieces();
+
+/*
+* Look up pos, from the side to moves point of view. Positions with castling rights or
+* a pawn that can be taken en passant are never found
+* returns: if pos was found. wdl is set to 1 (win), 0 (draw) or -1 (loss), dtm to the
+* number of halfmoves until mate, 0 for draws
+*/
+int tb_probe(struct Position* pos, int* wdl, int* dtm);
+
+/*
+* Same as tb_probe(), reading only the packed win/draw/loss values
+*/
+int tb_probe_wdl(struct Position* pos, int* wdl);
+
+/*
+* Generate the tables given by names (all of tb_names if num_names is 0) into dir, using
+* num_threads threads (0 = one per core). Tables the generated ones depend on must either
+* be generated first or already exist in dir
+* returns: success of operation
+*/
+int tb_generate(const char* dir, const char** names, int num_names, int num_threads, struct Tb_stats* stats);
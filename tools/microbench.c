@@ -0,0 +1,398 @@
+/**
+ * @file microbench.c
+ * @brief Timing the hot primitives of backend.c and engine.c in isolation
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * Standalone executable, built from the sources of the engine without main.c:
+ *
+ *      gcc -O2 -o microbench tools/microbench.c backend.c engine.c fen.c bench.c log.c profile.c \
+ *          book.c pgn.c tb.c pool.c simd.c nnue.c -lpthread
+ *
+ * usage: microbench [--pin cpu] [--samples n] [--warmup n] [--kernel name] [primitive ...]
+ *
+ * Every primitive is called once per position of the bench corpus, as often as needed
+ * to fill a sample of at least sample_ms. Reported are nanoseconds and time stamp
+ * counter cycles per call: mean, standard deviation and minimum over all samples.
+ */
+
+/*** Definitions ***/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "../backend.h"
+#include "../engine.h"
+#include "../fen.h"
+#include "../bench.h"
+#include "../simd.h"
+#include "../main.h"
+
+struct Corpus_entry {
+    struct Position position;
+
+    // First legal move, for the primitives playing a move
+    int has_move;
+    struct Move move;
+    char san[16];
+};
+
+struct Corpus {
+    struct Corpus_entry *entries;
+    int num_entries;
+
+    // Positions of the entries, for eval_batch()
+    struct Position *positions;
+
+    // Scratch game for eval_algebraic()
+    struct Game game;
+};
+
+/*
+* Run the primitive once on entry
+* returns: number of calls made, 0 if the primitive does not apply to entry
+*/
+typedef int (*Primitive_fn)(struct Corpus* corpus, struct Corpus_entry* entry);
+
+struct Primitive {
+    const char *name;
+    Primitive_fn run;
+};
+
+struct Sample_stats {
+    double mean;
+    double stddev;
+    double min;
+};
+
+/*** Constants ***/
+
+const int sample_ms = 20;
+const int default_samples = 15;
+const int default_warmup = 3;
+
+/*** Primitives ***/
+
+// Keeps the compiler from dropping the calls
+volatile int sink;
+
+int _run_gen_legal_moves(struct Corpus* corpus, struct Corpus_entry* entry) {
+    uint8_t from[MAX_MOVES], to[MAX_MOVES];
+    sink = gen_legal_moves(&entry->position, 0, from, to);
+    return 1;
+}
+
+int _run_in_check(struct Corpus* corpus, struct Corpus_entry* entry) {
+    sink = in_check(&entry->position);
+    return 1;
+}
+
+int _run_unsafe_play_move_to(struct Corpus* corpus, struct Corpus_entry* entry) {
+    if (!entry->has_move)
+        return 0;
+
+    struct Position new_pos;
+    unsafe_play_move_to(&entry->position, &new_pos, entry->move.from, entry->move.to, entry->move.promote);
+    sink = new_pos.state;
+    return 1;
+}
+
+int _run_update_state(struct Corpus* corpus, struct Corpus_entry* entry) {
+    struct Position pos = entry->position;
+    update_state(&pos);
+    sink = pos.state;
+    return 1;
+}
+
+int _run_eval_algebraic(struct Corpus* corpus, struct Corpus_entry* entry) {
+    if (!entry->has_move)
+        return 0;
+
+    corpus->game.halfmove = 0;
+    corpus->game.positions[0] = entry->position;
+    sink = eval_algebraic(&corpus->game, entry->san);
+    return 1;
+}
+
+int _run_static_eval(struct Corpus* corpus, struct Corpus_entry* entry) {
+    sink = static_eval(&entry->position);
+    return 1;
+}
+
+// Evaluates the whole corpus at once, counted on the first entry
+int _run_eval_batch(struct Corpus* corpus, struct Corpus_entry* entry) {
+    if (entry != corpus->entries)
+        return 0;
+
+    int out[corpus->num_entries];
+    eval_batch(corpus->positions, corpus->num_entries, out);
+
+    sink = out[0];
+    return corpus->num_entries;
+}
+
+const uint8_t flat_worth[64] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+int _run_board_terms(struct Corpus* corpus, struct Corpus_entry* entry) {
+    int counts[15];
+    sink = board_terms(entry->position.board, flat_worth, counts);
+    return 1;
+}
+
+const struct Primitive primitives[] = {
+    { "gen_legal_moves", _run_gen_legal_moves },
+    { "in_check", _run_in_check },
+    { "unsafe_play_move_to", _run_unsafe_play_move_to },
+    { "update_state", _run_update_state },
+    { "eval_algebraic", _run_eval_algebraic },
+    { "static_eval", _run_static_eval },
+    { "board_terms", _run_board_terms },
+    { "eval_batch", _run_eval_batch }
+};
+
+const int num_primitives = sizeof(primitives) / sizeof(primitives[0]);
+
+/*** Corpus ***/
+
+int _load_corpus(struct Corpus* corpus) {
+    corpus->entries = calloc(bench_num_positions, sizeof(struct Corpus_entry));
+    corpus->num_entries = 0;
+
+    for (int i = 0; i < bench_num_positions; i++) {
+        struct Corpus_entry *entry = &corpus->entries[corpus->num_entries];
+
+        if (read_fen(bench_positions[i], &entry->position, NULL) == 0) {
+            fprintf(stderr, "Skipping malformed position %d\n", i+1);
+            continue;
+        }
+
+        struct Move moves[MAX_MOVES];
+        int num_moves = gen_move_list(&entry->position, moves);
+
+        if (num_moves > 0) {
+            entry->has_move = 1;
+            entry->move = moves[0];
+            write_algebraic(&entry->position, moves, num_moves, moves[0], entry->san);
+        }
+
+        corpus->num_entries++;
+    }
+
+    corpus->positions = malloc(sizeof(struct Position) * corpus->num_entries);
+    for (int i = 0; i < corpus->num_entries; i++)
+        corpus->positions[i] = corpus->entries[i].position;
+
+    init_game(&corpus->game, &starting_position, 2);
+    return corpus->num_entries > 0;
+}
+
+/*** Measuring ***/
+
+double _now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+uint64_t _now_cycles() {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*
+* Run prim rounds times over the whole corpus
+* returns: number of calls made
+*/
+uint64_t _run_rounds(const struct Primitive* prim, struct Corpus* corpus, int rounds) {
+    uint64_t calls = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < corpus->num_entries; i++)
+            calls += prim->run(corpus, &corpus->entries[i]);
+    }
+
+    return calls;
+}
+
+/*
+* Newton's method, good enough for reporting
+*/
+double _sqrt(double x) {
+    if (x <= 0)
+        return 0;
+
+    double y = x > 1 ? x : 1;
+    for (int i = 0; i < 64; i++)
+        y = (y + x / y) / 2;
+
+    return y;
+}
+
+void _sample_stats(const double* samples, int num_samples, struct Sample_stats* stats) {
+    double sum = 0, min = samples[0];
+
+    for (int i = 0; i < num_samples; i++) {
+        sum += samples[i];
+        if (samples[i] < min)
+            min = samples[i];
+    }
+
+    double mean = sum / num_samples;
+    double variance = 0;
+
+    for (int i = 0; i < num_samples; i++)
+        variance += (samples[i] - mean) * (samples[i] - mean);
+
+    stats->mean = mean;
+    stats->stddev = num_samples > 1 ? _sqrt(variance / (num_samples - 1)) : 0;
+    stats->min = min;
+}
+
+void _measure(const struct Primitive* prim, struct Corpus* corpus, int num_samples, int num_warmup) {
+    // Warm up caches and branch predictors, and find the rounds filling one sample
+    int rounds = 1;
+
+    for (int i = 0; i < num_warmup; i++) {
+        for (;;) {
+            double start = _now_ns();
+            _run_rounds(prim, corpus, rounds);
+
+            if (_now_ns() - start >= sample_ms * 1e6 || rounds >= (1 << 24))
+                break;
+            rounds *= 2;
+        }
+    }
+
+    double *ns = malloc(sizeof(double) * num_samples);
+    double *cycles = malloc(sizeof(double) * num_samples);
+    uint64_t calls = 0;
+
+    for (int i = 0; i < num_samples; i++) {
+        double start_ns = _now_ns();
+        uint64_t start_cycles = _now_cycles();
+
+        calls = _run_rounds(prim, corpus, rounds);
+
+        uint64_t stop_cycles = _now_cycles();
+        double stop_ns = _now_ns();
+
+        if (calls == 0)
+            calls = 1;
+
+        ns[i] = (stop_ns - start_ns) / calls;
+        cycles[i] = (double)(stop_cycles - start_cycles) / calls;
+    }
+
+    struct Sample_stats ns_stats, cycle_stats;
+    _sample_stats(ns, num_samples, &ns_stats);
+    _sample_stats(cycles, num_samples, &cycle_stats);
+
+    printf("%-20s %10llu %10.1f %8.1f %10.1f",
+        prim->name, (unsigned long long)calls, ns_stats.mean, ns_stats.stddev, ns_stats.min);
+
+    if (HAVE_TSC)
+        printf(" %12.0f %10.0f %12.0f\n", cycle_stats.mean, cycle_stats.stddev, cycle_stats.min);
+    else
+        printf(" %12s %10s %12s\n", "-", "-", "-");
+
+    free(ns);
+    free(cycles);
+}
+
+/*** Main ***/
+
+int _pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+int main(int argc, char** argv) {
+    int num_samples = default_samples;
+    int num_warmup = default_warmup;
+    int pinned_cpu = -1;
+
+    const char *selected[16];
+    int num_selected = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if ( !strcmp(argv[i], "--pin") && i+1 < argc )
+            pinned_cpu = atoi(argv[++i]);
+        else if ( !strcmp(argv[i], "--samples") && i+1 < argc )
+            num_samples = atoi(argv[++i]);
+        else if ( !strcmp(argv[i], "--warmup") && i+1 < argc )
+            num_warmup = atoi(argv[++i]);
+        else if ( !strcmp(argv[i], "--kernel") && i+1 < argc ) {
+            if ( !select_eval_kernel(argv[++i]) ) {
+                fprintf(stderr, "kernel %s is not supported\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] != '-' && num_selected < 16)
+            selected[num_selected++] = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--pin cpu] [--samples n] [--warmup n] [--kernel name] [primitive ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (num_samples < 1)
+        num_samples = 1;
+    if (num_warmup < 1)
+        num_warmup = 1;
+
+    if (pinned_cpu >= 0 && !_pin_to_cpu(pinned_cpu)) {
+        fprintf(stderr, "could not pin to cpu %d\n", pinned_cpu);
+        return 1;
+    }
+
+    struct Corpus corpus;
+    if ( !_load_corpus(&corpus) ) {
+        fprintf(stderr, "empty corpus\n");
+        return 1;
+    }
+
+    printf("%d positions, %d samples of >= %dms, %s, %s kernel\n\n", corpus.num_entries, num_samples, sample_ms,
+        pinned_cpu >= 0 ? "pinned" : "not pinned", eval_kernel_name());
+    printf("%-20s %10s %10s %8s %10s %12s %10s %12s\n",
+        "primitive", "calls", "ns/op", "stddev", "min", "cycles/op", "stddev", "min");
+
+    for (int i = 0; i < num_primitives; i++) {
+        int run = num_selected == 0;
+
+        for (int j = 0; j < num_selected; j++)
+            run = run || !strcmp(selected[j], primitives[i].name);
+
+        if (run)
+            _measure(&primitives[i], &corpus, num_samples, num_warmup);
+    }
+
+    delete_game(&corpus.game);
+    free(corpus.entries);
+    free(corpus.positions);
+
+    return 0;
+}
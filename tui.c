@@ -13,15 +13,25 @@
 #include <wchar.h>
 #include <locale.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "tui.h"
 #include "main.h"
 #include "backend.h"
+#include "db.h"
+#include "explorer.h"
 
 #include "engine.h"
 
 struct Game game;
 
+const char *database_path = "games.db";
+
+// Built with "explorer build", its statistics are shown next to the board if it exists
+const char *explorer_path = "explorer.idx";
+struct Explorer explorer;
+
 /*** Definitions ***/
 
 enum State {
@@ -37,7 +47,7 @@ enum State {
 
 struct Window {
     WINDOW *win;
-} header_state, boardscr_state, input_state, about_state, error_state, victory_state;
+} header_state, boardscr_state, explorer_state, input_state, about_state, error_state, victory_state;
 
 struct Menu {
     WINDOW *win;
@@ -83,7 +93,7 @@ enum Sub_menu_return {
 /*** Initializing functions ***/
 
 void quit() {
-    log_msg("(tui) Exiting", log);
+    log_msg("(tui) Exiting", log_info);
     endwin();
 }
 
@@ -150,6 +160,18 @@ void setup_wins() {
         };
     }
 
+    // OPENING EXPLORER
+    {
+        int height = 12;
+        int width = 44;
+        int y = 2;
+        int x = 60;
+
+        explorer_state = (struct Window) {
+            newwin(height, width, y, x)
+        };
+    }
+
     // INPUT FIELD
     {
         int height = 3;
@@ -309,6 +331,39 @@ void draw_board(struct Window* state, struct Position* pos) {
 
 }
 
+void draw_explorer(struct Window* state, struct Position* pos) {
+    if (explorer.data == NULL)
+        return;
+
+    struct Explorer_move moves[MAX_MOVES];
+    struct Move legal_moves[MAX_MOVES];
+    int num_moves = explorer_probe(&explorer, pos, moves);
+    int num_legal_moves = gen_move_list(pos, legal_moves);
+
+    wclear(state->win);
+    box(state->win, 0, 0);
+    mvwprintw(state->win, 0, 2, " Explorer ");
+
+    wattron(state->win, A_DIM);
+    mvwprintw(state->win, 1, 2, "Move       Games   White  Draw Black");
+    wattroff(state->win, A_DIM);
+
+    if (num_moves == 0)
+        mvwprintw(state->win, 2, 2, "No games");
+
+    for (int i = 0; i < num_moves && i < 8; i++) {
+        char move[16];
+        write_algebraic(pos, legal_moves, num_legal_moves, moves[i].move, move);
+
+        mvwprintw(state->win, 2 + i, 2, "%-8s %7u   %4.0f%% %4.0f%% %4.0f%%", move, moves[i].games,
+            100.0 * moves[i].white_wins / moves[i].games, 100.0 * moves[i].draws / moves[i].games,
+            100.0 * moves[i].black_wins / moves[i].games
+        );
+    }
+
+    wrefresh(state->win);
+}
+
 void draw_input(struct Window* state, char* input) {
     wclear(state->win);
     box(state->win, 0, 0);
@@ -369,11 +424,98 @@ void draw_victory(struct Window* state, enum Game_state game_state) {
 
 /*** Implementing tui logic ***/
 
+/*
+* Append the current game to the database
+*/
+void save_game() {
+    char date[16];
+    time_t t = time(NULL);
+    strftime(date, 16, "%Y.%m.%d", localtime(&t));
+
+    char *result;
+    switch (game.positions[game.halfmove].state) {
+        case white_win: result = "1-0"; break;
+        case black_win: result = "0-1"; break;
+        case draw:      result = "1/2-1/2"; break;
+        default:        result = "*"; break;
+    }
+
+    struct Pgn_tag tags[3] = {
+        { {"Event", 5},  {"Casual game", 11} },
+        { {"Date", 4},   {date, strlen(date)} },
+        { {"Result", 6}, {result, strlen(result)} }
+    };
+
+    struct Db_buffer buffer;
+    struct Db_writer writer;
+    init_db_buffer(&buffer);
+
+    if (
+        db_buffer_add_played_game(&buffer, tags, 3, &game) &&
+        db_open_append(&writer, database_path)
+    ) {
+        db_write_buffer(&writer, &buffer);
+        db_finish(&writer);
+        log_msg("(tui) Saved game", log_info);
+    }
+
+    delete_db_buffer(&buffer);
+}
+
+/*
+* Ask for a game id and load that game from the database
+* returns: success of operation
+*/
+int load_game() {
+    struct Db db;
+    if ( !db_open(&db, database_path) )
+        return 0;
+
+    if (db.num_games == 0) {
+        log_msg("Error in load_game(): database has no games", error);
+        db_close(&db);
+        return 0;
+    }
+
+    curs_set(1);
+    echo();
+
+    werase(error_state.win);
+    mvwprintw(error_state.win, 0, 0, "Game (0-%llu)", (unsigned long long)db.num_games - 1);
+    wrefresh(error_state.win);
+
+    char inp[16] = {0};
+    draw_input(&input_state, inp);
+
+    curs_set(0);
+    noecho();
+    werase(error_state.win);
+    werase(input_state.win);
+
+    char *end;
+    unsigned long long id = strtoull(inp, &end, 10);
+    int ret = 0;
+
+    if (end != inp && *end == '\0' && id < db.num_games) {
+        delete_game(&game);
+        ret = db_load_game(&db, id, &game);
+
+        // Leave room for continuing the game
+        if (ret)
+            resize_game(&game, game.halfmove + 512);
+        else
+            init_game(&game, &starting_position, 512);
+    }
+
+    db_close(&db);
+    return ret;
+}
+
 void invoke_chess_engine() {
-    root.node_content.position = game.positions[game.halfmove];
+    struct Position *pos = choose_move(&game);
     game.halfmove++;
-    
-    game.positions[game.halfmove] = *choose_move(&root);
+
+    game.positions[game.halfmove] = *pos;
 }
 
 enum State handle_main_menu() {
@@ -394,10 +536,17 @@ enum State handle_main_menu() {
         break;
 
         case option_load_game:
-            return in_main_menu;
+            if ( !load_game() )
+                return in_main_menu;
+
+            log_msg("(tui) Loaded game", log_info);
+            main_menu_state.prev_state = in_game_human;
+            main_menu_state.continue_enabled = 1;
+            return in_game_human;
         break;
 
         case option_save_game:
+            save_game();
             return in_main_menu;
         break;
 
@@ -433,6 +582,7 @@ enum State handle_game(enum State state) {
         draw_error(&error_state);
 
     draw_board(&boardscr_state, &(game.positions[game.halfmove]));
+    draw_explorer(&explorer_state, &(game.positions[game.halfmove]));
 
     char inp[16];
     for(int i = 0; i < 16; i ++) {
@@ -441,9 +591,7 @@ enum State handle_game(enum State state) {
 
     draw_input(&input_state, inp);
 
-    char msg[64];
-    snprintf(msg, 64, "(tui) Interpreting input \'%s\'", inp);
-    log_msg(msg, verbose);
+    log_printf(verbose, "(tui) Interpreting input \'%s\'", inp);
     
     if( !strcmp(inp, "menu") || !strcmp(inp, "quit") || !strcmp(inp, "exit") ) {
         clear();
@@ -459,7 +607,7 @@ enum State handle_game(enum State state) {
 
     else if (state == in_game_engine || state == in_game_engine_with_error) {
         struct Position *last_pos = &game.positions[game.halfmove];
-        update_state(last_pos);
+        update_game_state(&game);
 
         if (last_pos->state != white && last_pos->state != black) {
             main_menu_state.continue_enabled = 0;
@@ -471,6 +619,14 @@ enum State handle_game(enum State state) {
         curs_set(0);
         invoke_chess_engine();
         curs_set(1);
+
+        last_pos = &game.positions[game.halfmove];
+        update_game_state(&game);
+
+        if (last_pos->state != white && last_pos->state != black) {
+            main_menu_state.continue_enabled = 0;
+            return in_victory_screen;
+        }
     }
 
     // Clear input buffer
@@ -553,5 +709,8 @@ void init_tui() {
     init_curses();
     setup_wins();
 
+    if (access(explorer_path, R_OK) == 0)
+        explorer_open(&explorer, explorer_path);
+
     init_game(&game, &starting_position, 512);
 }
\ No newline at end of file
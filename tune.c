@@ -0,0 +1,457 @@
+/**
+ * @file tune.c
+ * @brief Fitting the weights of static_eval() to game results, see tune.h
+ * @version 1.0
+ * @date 19.10.2026
+ *
+ * static_eval() is linear in its weights, so every position is reduced once to the
+ * feature vector of eval_features(). Evaluating the whole data set with new weights is
+ * then a dot product per position, and the gradient of the error comes for free.
+ */
+
+/*** Definitions ***/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "tune.h"
+#include "backend.h"
+#include "engine.h"
+#include "fen.h"
+#include "pgn.h"
+#include "datagen.h"
+#include "pool.h"
+#include "main.h"
+
+struct Tune_entry {
+    int8_t features[NUM_EVAL_PARAMS];
+
+    // 1 white won, 0.5 draw, 0 black won
+    float result;
+};
+
+struct Labelled_position {
+    struct Position position;
+    float result;
+};
+
+struct Tune_data {
+    struct Labelled_position *positions;
+    uint64_t num_positions;
+    uint64_t capacity;
+
+    struct Tune_entry *entries;
+    uint64_t num_entries;
+
+    // Set for the positions that made it into entries
+    uint8_t *valid;
+};
+
+struct Tune_job {
+    struct Tune_data *data;
+
+    const double *weights;
+    double k;
+
+    // Partial sums of every chunk, added up in order so results do not depend on threads
+    double *errors;
+    double (*gradients)[NUM_EVAL_PARAMS];
+    int with_gradient;
+};
+
+/*** Constants ***/
+
+// Opening moves of PGN games, mostly from books
+const int tune_skip_plies = 8;
+
+const uint64_t tune_chunk_size = 1 << 12;
+
+// Adam
+const double tune_learning_rate = 3.0;
+const double tune_beta1 = 0.9;
+const double tune_beta2 = 0.999;
+
+/*** Math ***/
+
+/*
+* Winning chance of white
+*/
+double _sigmoid(double eval, double k) {
+    return 1 / (1 + pow(10, -k * eval / 4000));
+}
+
+/*** Data ***/
+
+void _add_position(struct Tune_data* data, struct Position* pos, float result) {
+    if (data->num_positions == data->capacity) {
+        data->capacity = data->capacity ? 2 * data->capacity : 1 << 16;
+        data->positions = realloc(data->positions, sizeof(struct Labelled_position) * data->capacity);
+    }
+
+    data->positions[data->num_positions++] = (struct Labelled_position) { *pos, result };
+}
+
+void _add_labelled_game(struct Tune_data* data, struct Pgn_game* game) {
+    if (game->result == white || pgn_find_tag(game, "FEN") != NULL)
+        return;
+
+    float result = (game->result == white_win) ? 1 : (game->result == black_win ? 0 : 0.5);
+
+    struct Position positions[2];
+    positions[0] = starting_position;
+    char string[16];
+
+    for (int i = 0; i < game->num_moves; i++) {
+        struct Position *crnt_pos = &positions[i % 2];
+        struct Move move;
+
+        if ( !pgn_move_string(&game->moves[i], string) || !parse_algebraic(crnt_pos, string, &move) )
+            return;
+
+        unsafe_play_move_to(crnt_pos, &positions[(i+1) % 2], move.from, move.to, move.promote);
+
+        if (i + 1 >= tune_skip_plies)
+            _add_position(data, &positions[(i+1) % 2], result);
+    }
+}
+
+int _read_pgn(struct Tune_data* data, const char* path, struct Tune_stats* stats) {
+    struct Pgn_reader reader;
+    struct Pgn_game game;
+
+    if ( !pgn_open(&reader, path) ) {
+        log_msg("Error in _read_pgn(): could not open file", error);
+        return 0;
+    }
+
+    while ( pgn_next_game(&reader, &game) ) {
+        _add_labelled_game(data, &game);
+        stats->games++;
+    }
+
+    pgn_close(&reader);
+    return 1;
+}
+
+/*
+* returns: if line holds a result
+*/
+int _line_result(const char* line, float* result) {
+    // Before 1-0 and 0-1, which could match inside the draw
+    if (strstr(line, "1/2-1/2") || strstr(line, "[0.5]"))
+        *result = 0.5;
+    else if (strstr(line, "1-0") || strstr(line, "[1.0]"))
+        *result = 1;
+    else if (strstr(line, "0-1") || strstr(line, "[0.0]"))
+        *result = 0;
+    else
+        return 0;
+
+    return 1;
+}
+
+int _read_positions(struct Tune_data* data, const char* path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        log_msg("Error in _read_positions(): could not open file", error);
+        return 0;
+    }
+
+    char line[1024];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        struct Position pos;
+        float result;
+
+        line_number++;
+
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        int length = read_fen(line, &pos, NULL);
+
+        if (length == 0 || !_line_result(line + length, &result)) {
+            log_printf(error, "Error in _read_positions(): line %d is not a position with a result", line_number);
+            continue;
+        }
+
+        _add_position(data, &pos, result);
+    }
+
+    fclose(file);
+    return 1;
+}
+
+/*
+* Positions written by generate_data()
+*/
+int _read_packed(struct Tune_data* data, const char* path) {
+    struct Packed_reader reader;
+    struct Packed_position packed;
+
+    if ( !packed_reader_open(&reader, path) )
+        return 0;
+
+    while ( packed_read(&reader, &packed) ) {
+        struct Position pos;
+        unpack_position(&packed, &pos, NULL);
+
+        _add_position(data, &pos, (packed.result + 1) / 2.0f);
+    }
+
+    packed_reader_close(&reader);
+    return 1;
+}
+
+/*
+* Resolve captures and reduce the positions to features
+*/
+void _prepare_chunk(int index, void* arg) {
+    struct Tune_data *data = arg;
+
+    uint64_t start = index * tune_chunk_size;
+    uint64_t end = start + tune_chunk_size < data->num_positions ? start + tune_chunk_size : data->num_positions;
+
+    for (uint64_t i = start; i < end; i++) {
+        struct Position quiet;
+        struct Position *pos = &data->positions[i].position;
+
+        data->valid[i] = 0;
+
+        // Mates and stalemates are not up to the evaluation
+        struct Move moves[MAX_MOVES];
+        if (gen_move_list(pos, moves) == 0)
+            continue;
+
+        quiet_position(pos, &quiet);
+
+        if ( cached_in_check(&quiet) )
+            continue;
+
+        eval_features(&quiet, data->entries[i].features);
+        data->entries[i].result = data->positions[i].result;
+        data->valid[i] = 1;
+    }
+}
+
+/*** Error ***/
+
+void _error_chunk(int index, void* arg) {
+    struct Tune_job *job = arg;
+    struct Tune_data *data = job->data;
+
+    uint64_t start = index * tune_chunk_size;
+    uint64_t end = start + tune_chunk_size < data->num_entries ? start + tune_chunk_size : data->num_entries;
+
+    double error = 0;
+    double gradient[NUM_EVAL_PARAMS] = {0};
+
+    for (uint64_t i = start; i < end; i++) {
+        const struct Tune_entry *entry = &data->entries[i];
+        double eval = 0;
+
+        for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+            eval += job->weights[j] * entry->features[j];
+
+        double chance = _sigmoid(eval, job->k);
+        double diff = chance - entry->result;
+
+        error += diff * diff;
+
+        if (job->with_gradient) {
+            double slope = diff * chance * (1 - chance);
+
+            for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+                gradient[j] += slope * entry->features[j];
+        }
+    }
+
+    job->errors[index] = error;
+
+    if (job->with_gradient)
+        memcpy(job->gradients[index], gradient, sizeof(gradient));
+}
+
+/*
+* returns: mean squared error of weights. If gradient is given, it is set to the
+* gradient of the error
+*/
+double _error(struct Tune_data* data, const double* weights, double k, int num_threads, double* gradient) {
+    int num_chunks = (data->num_entries + tune_chunk_size - 1) / tune_chunk_size;
+
+    struct Tune_job job = {
+        .data = data,
+        .weights = weights,
+        .k = k,
+        .errors = malloc(sizeof(double) * num_chunks),
+        .gradients = gradient ? malloc(sizeof(double[NUM_EVAL_PARAMS]) * num_chunks) : NULL,
+        .with_gradient = gradient != NULL
+    };
+
+    parallel_for(num_chunks, num_threads, _error_chunk, &job);
+
+    double error = 0;
+
+    if (gradient)
+        memset(gradient, 0, sizeof(double) * NUM_EVAL_PARAMS);
+
+    for (int i = 0; i < num_chunks; i++) {
+        error += job.errors[i];
+
+        for (int j = 0; gradient && j < NUM_EVAL_PARAMS; j++)
+            gradient[j] += job.gradients[i][j];
+    }
+
+    // The constant factors of the derivative of the sigmoid
+    for (int j = 0; gradient && j < NUM_EVAL_PARAMS; j++)
+        gradient[j] *= 2 * k * log(10) / 4000 / data->num_entries;
+
+    free(job.errors);
+    free(job.gradients);
+
+    return error / data->num_entries;
+}
+
+/*
+* Golden section search for the k with the smallest error
+*/
+double _fit_k(struct Tune_data* data, const double* weights, int num_threads) {
+    const double ratio = 0.61803398874989484820;
+
+    double low = 0.01, high = 4;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double error_a = _error(data, weights, a, num_threads, NULL);
+    double error_b = _error(data, weights, b, num_threads, NULL);
+
+    for (int i = 0; i < 40; i++) {
+        if (error_a < error_b) {
+            high = b;
+            b = a;
+            error_b = error_a;
+            a = high - ratio * (high - low);
+            error_a = _error(data, weights, a, num_threads, NULL);
+        }
+        else {
+            low = a;
+            a = b;
+            error_a = error_b;
+            b = low + ratio * (high - low);
+            error_b = _error(data, weights, b, num_threads, NULL);
+        }
+    }
+
+    return (low + high) / 2;
+}
+
+/*** Functions ***/
+
+int tune_eval(const char* data_path, const char* params_path, int iterations, int num_threads, struct Tune_stats* stats) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(stats, 0, sizeof(struct Tune_stats));
+
+    struct Tune_data data = {0};
+    size_t length = strlen(data_path);
+
+    int ret;
+
+    if (length > 4 && !strcmp(data_path + length - 4, ".pgn"))
+        ret = _read_pgn(&data, data_path, stats);
+    else if (length > 7 && !strcmp(data_path + length - 7, ".packed"))
+        ret = _read_packed(&data, data_path);
+    else
+        ret = _read_positions(&data, data_path);
+
+    if (!ret || data.num_positions == 0) {
+        log_msg("Error in tune_eval(): no positions to tune on", error);
+        free(data.positions);
+        return 0;
+    }
+
+    data.entries = malloc(sizeof(struct Tune_entry) * data.num_positions);
+    data.valid = malloc(data.num_positions);
+
+    parallel_for((data.num_positions + tune_chunk_size - 1) / tune_chunk_size, num_threads, _prepare_chunk, &data);
+
+    for (uint64_t i = 0; i < data.num_positions; i++) {
+        if (data.valid[i])
+            data.entries[data.num_entries++] = data.entries[i];
+    }
+
+    free(data.positions);
+    free(data.valid);
+    data.positions = NULL;
+
+    stats->positions = data.num_entries;
+    log_printf(log_info, "(tune) %llu quiet positions", (unsigned long long)data.num_entries);
+
+    if (data.num_entries == 0) {
+        free(data.entries);
+        return 0;
+    }
+
+    int vector[NUM_EVAL_PARAMS];
+    eval_params_to_vector(&eval_params, vector);
+
+    double weights[NUM_EVAL_PARAMS], gradient[NUM_EVAL_PARAMS];
+    double moment[NUM_EVAL_PARAMS] = {0}, velocity[NUM_EVAL_PARAMS] = {0};
+
+    for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+        weights[j] = vector[j];
+
+    stats->k = _fit_k(&data, weights, num_threads);
+    stats->initial_error = _error(&data, weights, stats->k, num_threads, NULL);
+
+    double power1 = 1, power2 = 1;
+
+    for (stats->iterations = 0; stats->iterations < iterations; stats->iterations++) {
+        double error = _error(&data, weights, stats->k, num_threads, gradient);
+
+        if (stats->iterations % 100 == 0) {
+            printf("iteration %5d, error %.6f\n", stats->iterations, error);
+            fflush(stdout);
+        }
+
+        power1 *= tune_beta1;
+        power2 *= tune_beta2;
+
+        for (int j = 0; j < NUM_EVAL_PARAMS; j++) {
+            moment[j] = tune_beta1 * moment[j] + (1 - tune_beta1) * gradient[j];
+            velocity[j] = tune_beta2 * velocity[j] + (1 - tune_beta2) * gradient[j] * gradient[j];
+
+            double corrected_moment = moment[j] / (1 - power1);
+            double corrected_velocity = velocity[j] / (1 - power2);
+
+            weights[j] -= tune_learning_rate * corrected_moment / (sqrt(corrected_velocity) + 1e-12);
+
+            // Worth of squares are bytes
+            if (j >= 5)
+                weights[j] = weights[j] < 0 ? 0 : (weights[j] > UINT8_MAX ? UINT8_MAX : weights[j]);
+        }
+    }
+
+    for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+        vector[j] = (int)(weights[j] + (weights[j] >= 0 ? 0.5 : -0.5));
+
+    struct Eval_params params = eval_params;
+    eval_params_from_vector(&params, vector);
+
+    for (int j = 0; j < NUM_EVAL_PARAMS; j++)
+        weights[j] = vector[j];
+
+    stats->final_error = _error(&data, weights, stats->k, num_threads, NULL);
+    free(data.entries);
+
+    ret = save_eval_params(params_path, &params);
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    stats->seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    return ret;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "engine.h"
+
+struct Tune_stats {
+    uint64_t games;
+    uint64_t positions;
+
+    // Scaling of evaluations to winning chances, fitted to the initial weights
+    double k;
+
+    // Mean squared difference of results and winning chances
+    double initial_error;
+    double final_error;
+
+    int iterations;
+    double seconds;
+};
+
+/*
+* Fit eval_params to the results of the positions in data_path, minimizing
+*
+*   E = 1/N * sum of (result - 1 / (1 + 10^(-k * eval / 4000)))^2
+*
+* by gradient descent. Positions are first made quiet with quiet_position().
+*
+* data_path is either a PGN file, labelling every position after the opening with the
+* result of its game, or a file of FEN/EPD lines with a result in each line: 1-0, 0-1,
+* 1/2-1/2 (e.g. as c9 "1-0";) or [1.0], [0.5], [0.0]. Files ending in ".packed" are read as
+* training data of generate_data().
+*
+* The tuned weights are written to params_path, see save_eval_params(). Positions are
+* processed by num_threads threads (0 = one per core)
+* returns: success of operation
+*/
+int tune_eval(const char* data_path, const char* params_path, int iterations, int num_threads, struct Tune_stats* stats);